@@ -0,0 +1,80 @@
+// Latency and throughput of bst_t insert, has and remove.
+// Keys are random, so the unbalanced tree stays about 3 ln(n) deep.
+//
+// Usage: bst_bench [max size]
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "bst.h"
+#include "bench.h"
+
+static void bench_size(size_t size, std::mt19937& rng) {
+  std::vector<int> keys(size);
+  for (size_t i = 0; i < size; ++i) {
+    keys[i] = (int)(rng() >> 1);
+  }
+
+  bst_t tree;
+  latency_t latency;
+  latency.reserve(size);
+
+  uint64_t start = bench_now_ns();
+  for (auto key : keys) {
+    uint64_t t = bench_now_ns();
+    tree.insert(key);
+    latency.add(bench_now_ns() - t);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("bst", "insert", size, 1, size, seconds, latency);
+
+  // Half of the lookups hit.
+  std::vector<int> queries(size);
+  for (size_t i = 0; i < size; ++i) {
+    queries[i] = i % 2 ? keys[rng() % size] : (int)(rng() >> 1);
+  }
+
+  latency_t has_latency;
+  has_latency.reserve(size);
+  size_t found = 0;
+
+  start = bench_now_ns();
+  for (auto key : queries) {
+    uint64_t t = bench_now_ns();
+    found += tree.has(key);
+    has_latency.add(bench_now_ns() - t);
+  }
+  seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("bst", "has", size, 1, size, seconds, has_latency);
+
+  if (found < size / 2) {
+    std::cerr << "has: found " << found << " of " << size << std::endl;
+  }
+
+  std::shuffle(keys.begin(), keys.end(), rng);
+
+  latency_t remove_latency;
+  remove_latency.reserve(size);
+
+  start = bench_now_ns();
+  for (auto key : keys) {
+    uint64_t t = bench_now_ns();
+    tree.remove(key);
+    remove_latency.add(bench_now_ns() - t);
+  }
+  seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("bst", "remove", size, 1, size, seconds, remove_latency);
+}
+
+int main(int argc, char *argv[])
+{
+  size_t max_size = argc > 1 ? atol(argv[1]) : 1000000;
+  std::mt19937 rng(1);
+
+  for (size_t size = 1000; size <= max_size; size *= 10) {
+    bench_size(size, rng);
+  }
+
+  return 0;
+}
@@ -0,0 +1,200 @@
+// learned_index_t against bst_t on mostly monotone timestamps: memory,
+// has() latency, range() and inserts through the delta buffer.
+// bst_t is built twice. Once by inserts in arrival order, which makes it
+// a list, so only its first ARRIVAL_SIZE keys are inserted. Then from
+// the sorted keys by medians, with make_minimal_tree() as src/main.cc.
+// Memory is the growth of the heap while a structure is built.
+//
+// Usage: learned_bench [size] [input file of src/main.cc]
+// With an input file, the keys of all its cases are used instead.
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <malloc.h>
+#include "bst.h"
+#include "learned_index.h"
+#include "bench.h"
+
+#define ARRIVAL_SIZE 20000
+#define N_QUERIES 1000000
+#define RANGE_WIDTH 1000
+
+static size_t heap_bytes() {
+  return mallinfo2().uordblks;
+}
+
+// Timestamps that mostly grow, some equal, and one in a hundred late.
+static std::vector<int> timestamps(size_t size, std::mt19937 &rng) {
+  std::vector<int> keys(size);
+  int now = 0;
+  for (auto &key : keys) {
+    now += rng() % 8;
+    key = rng() % 100 ? now : now - (int)(rng() % 10000);
+  }
+  return keys;
+}
+
+// The cases of src/main.cc's input, one after the other.
+static std::vector<int> read_input(const char *path) {
+  std::vector<int> keys;
+  std::ifstream in(path);
+  int tc = 0;
+  in >> tc;
+  for (int t = 0; t < tc; ++t) {
+    int num_elem = 0;
+    in >> num_elem;
+    for (int i = 0; i < num_elem; ++i) {
+      int key;
+      in >> key;
+      keys.push_back(key);
+    }
+  }
+  return keys;
+}
+
+template <typename T>
+static void bench_has(T &index, const char *on, size_t size, size_t bytes,
+                      const std::vector<int> &queries) {
+  latency_t latency;
+  latency.reserve(queries.size());
+  size_t found = 0;
+
+  uint64_t start = bench_now_ns();
+  for (auto key : queries) {
+    uint64_t t = bench_now_ns();
+    found += index.has(key);
+    latency.add(bench_now_ns() - t);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+
+  char extra[96];
+  snprintf(extra, sizeof(extra), ", \"on\": \"%s\", \"bytes\": %zu"
+      ", \"found\": %zu", on, bytes, found);
+  bench_report("bst", "has", size, 1, queries.size(), seconds, latency,
+      extra);
+}
+
+// Half of the lookups hit.
+static std::vector<int> make_queries(const std::vector<int> &keys,
+                                     size_t n, std::mt19937 &rng) {
+  int max_key = *std::max_element(keys.begin(), keys.end());
+  std::vector<int> queries(n);
+  for (size_t i = 0; i < n; ++i) {
+    queries[i] = i % 2 ? keys[rng() % keys.size()]
+      : (int)(rng() % ((unsigned)max_key + 1));
+  }
+  return queries;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t size = argc > 1 ? atol(argv[1]) : 10000000;
+  std::mt19937 rng(1);
+  std::vector<int> keys = argc > 2 ? read_input(argv[2])
+    : timestamps(size, rng);
+  size = keys.size();
+  if (size == 0) {
+    std::cerr << "learned_bench: no keys" << std::endl;
+    return 1;
+  }
+
+  // Inserts in arrival order.
+  {
+    std::vector<int> arrival(keys.begin(),
+        keys.begin() + std::min(size, (size_t)ARRIVAL_SIZE));
+    size_t before = heap_bytes();
+    bst_t tree;
+    for (auto key : arrival) {
+      tree.insert(key);
+    }
+    size_t bytes = heap_bytes() - before;
+    std::cerr << "bst_t of " << arrival.size() << " keys in arrival order"
+      << " has height " << tree.get_height() << std::endl;
+    bench_has(tree, "bst_arrival", arrival.size(), bytes,
+        make_queries(arrival, ARRIVAL_SIZE, rng));
+  }
+
+  std::vector<int> queries = make_queries(keys, N_QUERIES, rng);
+
+  {
+    std::vector<int> sorted(keys);
+    std::sort(sorted.begin(), sorted.end());
+    size_t before = heap_bytes();
+    bst_t tree;
+    make_minimal_tree(tree, sorted, 0, sorted.size());
+    size_t bytes = heap_bytes() - before;
+    bench_has(tree, "bst_median", size, bytes, queries);
+  }
+
+  learned_index_t index;
+  size_t before = heap_bytes();
+  latency_t build_latency;
+  uint64_t start = bench_now_ns();
+  index.build(keys);
+  build_latency.add(bench_now_ns() - start);
+  size_t bytes = heap_bytes() - before;
+
+  char extra[96];
+  snprintf(extra, sizeof(extra), ", \"segments\": %zu, \"bytes\": %zu",
+      index.get_num_segments(), index.memory_bytes());
+  bench_report("bst", "learned_build", size, 1, 1,
+      (bench_now_ns() - start) * 1e-9, build_latency, extra);
+  bench_has(index, "learned", size, bytes, queries);
+
+  // Windows of RANGE_WIDTH keys, checked against the sorted keys.
+  std::vector<int> sorted(keys);
+  std::sort(sorted.begin(), sorted.end());
+  latency_t range_latency;
+  range_latency.reserve(N_QUERIES / 10);
+  std::vector<int> out;
+  size_t n_keys = 0;
+  bool correct = true;
+  start = bench_now_ns();
+  for (size_t i = 0; i < N_QUERIES / 10; ++i) {
+    int low = queries[i];
+    int high = low + RANGE_WIDTH;
+    out.clear();
+    uint64_t t = bench_now_ns();
+    n_keys += index.range(low, high, out);
+    range_latency.add(bench_now_ns() - t);
+    if (i % 1000 == 0) {
+      auto first = std::lower_bound(sorted.begin(), sorted.end(), low);
+      auto last = std::upper_bound(sorted.begin(), sorted.end(), high);
+      correct = correct && std::equal(first, last, out.begin())
+        && (size_t)(last - first) == out.size();
+    }
+  }
+  snprintf(extra, sizeof(extra), ", \"width\": %d, \"keys\": %zu",
+      RANGE_WIDTH, n_keys);
+  bench_report("bst", "learned_range", size, 1, N_QUERIES / 10,
+      (bench_now_ns() - start) * 1e-9, range_latency, extra);
+  if (!correct) {
+    std::cerr << "learned_bench: range() differs from the sorted keys"
+      << std::endl;
+  }
+
+  // New timestamps, merged every LEARNED_INDEX_DELTA_SIZE inserts.
+  std::vector<int> later = timestamps(N_QUERIES / 10, rng);
+  int last_key = sorted.back();
+  latency_t insert_latency;
+  insert_latency.reserve(later.size());
+  start = bench_now_ns();
+  for (auto key : later) {
+    uint64_t t = bench_now_ns();
+    index.insert(last_key + key);
+    insert_latency.add(bench_now_ns() - t);
+  }
+  bench_report("bst", "learned_insert", size, 1, later.size(),
+      (bench_now_ns() - start) * 1e-9, insert_latency);
+
+  if (index.size() != (int64_t)(size + later.size())
+      || !index.has(last_key + later.back()) || !index.has(sorted[0])) {
+    std::cerr << "learned_bench: keys lost by inserts" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,146 @@
+// A writer inserting and removing random keys while readers take views of
+// the key set, each followed by has() of LOOKUPS keys. With bst_t, a view
+// is a copy taken while the writer is stopped by a mutex. With pbst_t, it
+// is a snapshot. Ops of the writer are updates, of a reader views.
+//
+// Usage: pbst_bench [size] [readers] [seconds]
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include "bst.h"
+#include "pbst.h"
+#include "bench.h"
+
+#define LOOKUPS 1000
+
+// Unique random keys below 2 * size, in random order.
+static std::vector<int> random_keys(size_t size, std::mt19937 &rng) {
+  std::vector<int> keys(2 * size);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    keys[i] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), rng);
+  keys.resize(size);
+  return keys;
+}
+
+// update(key, insert) and view() as the writer and the readers run them.
+template <typename U, typename V>
+static void run(const char *on, size_t size, int n_readers, double seconds,
+                U update, V view) {
+  std::atomic<bool> stop(false);
+  latency_t update_latency;
+  std::vector<latency_t> view_latency(n_readers);
+  std::vector<std::thread> readers;
+
+  uint64_t start = bench_now_ns();
+  for (int r = 0; r < n_readers; ++r) {
+    readers.emplace_back([&, r]() {
+      std::mt19937 rng(r + 2);
+      while (!stop.load()) {
+        uint64_t t = bench_now_ns();
+        view(rng);
+        view_latency[r].add(bench_now_ns() - t);
+      }
+    });
+  }
+
+  std::mt19937 rng(1);
+  uint64_t end = start + (uint64_t)(seconds * 1e9);
+  while (bench_now_ns() < end) {
+    int key = rng() % (2 * size);
+    uint64_t t = bench_now_ns();
+    update(key, rng() % 2 == 0);
+    update_latency.add(bench_now_ns() - t);
+  }
+  stop.store(true);
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  double elapsed = (bench_now_ns() - start) * 1e-9;
+
+  char extra[64];
+  snprintf(extra, sizeof(extra), ", \"on\": \"%s\"", on);
+  bench_report("bst", "update", size, 1 + n_readers,
+      update_latency.count(), elapsed, update_latency, extra);
+
+  latency_t all_views;
+  for (auto &latency : view_latency) {
+    all_views.merge(latency);
+  }
+  snprintf(extra, sizeof(extra), ", \"on\": \"%s\", \"lookups\": %d", on,
+      LOOKUPS);
+  bench_report("bst", "view", size, 1 + n_readers, all_views.count(),
+      elapsed, all_views, extra);
+}
+
+int main(int argc, char *argv[])
+{
+  size_t size = argc > 1 ? atol(argv[1]) : 1000000;
+  int n_readers = argc > 2 ? atoi(argv[2]) : 2;
+  double seconds = argc > 3 ? atof(argv[3]) : 5;
+  std::mt19937 rng(1);
+  std::vector<int> keys = random_keys(size, rng);
+
+  {
+    bst_t tree;
+    std::mutex mutex;
+    for (auto key : keys) {
+      tree.insert(key);
+    }
+
+    run("bst_copy", size, n_readers, seconds,
+        [&](int key, bool insert) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (insert) {
+            tree.insert(key);
+          } else {
+            tree.remove(key);
+          }
+        },
+        [&](std::mt19937 &rng) {
+          mutex.lock();
+          bst_t copy(tree);
+          mutex.unlock();
+          for (int i = 0; i < LOOKUPS; ++i) {
+            copy.has(rng() % (2 * size));
+          }
+        });
+  }
+
+  pbst_t tree;
+  for (auto key : keys) {
+    tree.insert(key);
+  }
+  int64_t allocated = tree.get_allocated_nodes();
+  uint64_t version = tree.get_version();
+
+  run("pbst_snapshot", size, n_readers, seconds,
+      [&](int key, bool insert) {
+        if (insert) {
+          tree.insert(key);
+        } else {
+          tree.remove(key);
+        }
+      },
+      [&](std::mt19937 &rng) {
+        pbst_t::snapshot_t snapshot = tree.snapshot();
+        for (int i = 0; i < LOOKUPS; ++i) {
+          snapshot.has(rng() % (2 * size));
+        }
+      });
+
+  uint64_t updates = tree.get_version() - version;
+  std::cerr << "pbst_t: " << updates << " updates allocated "
+    << tree.get_allocated_nodes() - allocated << " nodes, "
+    << tree.get_retired_nodes() << " retired at the end, height "
+    << tree.snapshot().get_height() << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,146 @@
+// Union, intersection and difference of two bst_t of random keys, half of
+// them shared. The naive loop calls has() and insert() once per key; the
+// join-based operations run on n_threads threads. Ops are the keys of both
+// trees.
+//
+// Usage: set_bench [size] [max threads]
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include "bst.h"
+#include "bench.h"
+
+enum set_op_t { UNION, INTERSECTION, DIFFERENCE };
+
+static const char* op_names[] = {"union", "intersection", "difference"};
+
+static void report(set_op_t op, const char *method, size_t size,
+                   int n_threads, double seconds) {
+  latency_t latency;
+  latency.add(seconds * 1e9);
+
+  char extra[64];
+  snprintf(extra, sizeof(extra), ", \"method\": \"%s\"", method);
+  bench_report("bst", op_names[op], size, n_threads, 2 * size, seconds,
+      latency, extra);
+}
+
+static void check(set_op_t op, const char *method, bst_t &result,
+                  size_t expected) {
+  if ((size_t)result.size() != expected) {
+    std::cerr << "set_bench: " << op_names[op] << " (" << method
+      << ") has " << result.size() << " keys, not " << expected
+      << std::endl;
+  }
+}
+
+// Unique random keys, in random order.
+static std::vector<int> random_keys(size_t size, std::mt19937 &rng) {
+  std::vector<int> keys(size);
+  for (auto &key : keys) {
+    key = (int)(rng() >> 1);
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  std::shuffle(keys.begin(), keys.end(), rng);
+  return keys;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t size = argc > 1 ? atol(argv[1]) : 10000000;
+  int max_threads = argc > 2 ? atoi(argv[2]) : 4;
+  std::mt19937 rng(1);
+
+  std::vector<int> a_keys = random_keys(size, rng);
+  std::vector<int> b_keys = random_keys(size / 2, rng);
+  b_keys.insert(b_keys.end(), a_keys.begin(), a_keys.begin() + size / 2);
+  std::sort(b_keys.begin(), b_keys.end());
+  b_keys.erase(std::unique(b_keys.begin(), b_keys.end()), b_keys.end());
+  std::shuffle(b_keys.begin(), b_keys.end(), rng);
+
+  size_t expected[3];
+  {
+    std::vector<int> a_sorted(a_keys), b_sorted(b_keys), out;
+    std::sort(a_sorted.begin(), a_sorted.end());
+    std::sort(b_sorted.begin(), b_sorted.end());
+    std::set_union(a_sorted.begin(), a_sorted.end(), b_sorted.begin(),
+        b_sorted.end(), std::back_inserter(out));
+    expected[UNION] = out.size();
+    out.clear();
+    std::set_intersection(a_sorted.begin(), a_sorted.end(),
+        b_sorted.begin(), b_sorted.end(), std::back_inserter(out));
+    expected[INTERSECTION] = out.size();
+    out.clear();
+    std::set_difference(a_sorted.begin(), a_sorted.end(), b_sorted.begin(),
+        b_sorted.end(), std::back_inserter(out));
+    expected[DIFFERENCE] = out.size();
+  }
+
+  bst_t a, b;
+  for (auto key : a_keys) {
+    a.insert(key);
+  }
+  for (auto key : b_keys) {
+    b.insert(key);
+  }
+
+  // Naive: one lookup per key, and an insert per key of the result.
+  for (int op = UNION; op <= DIFFERENCE; ++op) {
+    bst_t result;
+    if (op == UNION) {
+      result = a;
+    }
+
+    uint64_t start = bench_now_ns();
+    if (op == UNION) {
+      for (auto key : b_keys) {
+        if (!result.has(key)) {
+          result.insert(key);
+        }
+      }
+    } else {
+      for (auto key : a_keys) {
+        if (b.has(key) == (op == INTERSECTION)) {
+          result.insert(key);
+        }
+      }
+    }
+    report((set_op_t)op, "naive", size, 1, (bench_now_ns() - start) * 1e-9);
+    check((set_op_t)op, "naive", result, expected[op]);
+  }
+
+  // The first set operation on a tree balances it.
+  uint64_t start = bench_now_ns();
+  a.balance();
+  b.balance();
+  latency_t balance_latency;
+  balance_latency.add(bench_now_ns() - start);
+  bench_report("bst", "balance", size, 1, a_keys.size() + b_keys.size(),
+      (bench_now_ns() - start) * 1e-9, balance_latency);
+
+  for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+    for (int op = UNION; op <= DIFFERENCE; ++op) {
+      bst_t result(a), other(b);
+
+      start = bench_now_ns();
+      if (op == UNION) {
+        result.unite(other, n_threads);
+      } else if (op == INTERSECTION) {
+        result.intersect(other, n_threads);
+      } else {
+        result.subtract(other, n_threads);
+      }
+      report((set_op_t)op, "join", size, n_threads,
+          (bench_now_ns() - start) * 1e-9);
+      check((set_op_t)op, "join", result, expected[op]);
+    }
+  }
+
+  return 0;
+}
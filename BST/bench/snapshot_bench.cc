@@ -0,0 +1,123 @@
+// Startup time of a bst_t read from text, as src/main.cc reads stdin,
+// against mapping a snapshot saved by bst_t::save(). Startup ends with
+// the first lookup. Lookups on both follow.
+// The files were just written, so they are in the page cache.
+//
+// Usage: snapshot_bench [size] [directory for the files]
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include "bst.h"
+#include "bst_snapshot.h"
+#include "bench.h"
+
+// Lookups on t, half of which hit. Returns the number found.
+template <typename T>
+static size_t bench_has(const T &t, const char *on,
+                        const std::vector<int> &queries) {
+  latency_t latency;
+  latency.reserve(queries.size());
+  size_t found = 0;
+
+  uint64_t start = bench_now_ns();
+  for (auto key : queries) {
+    uint64_t t0 = bench_now_ns();
+    found += t.has(key);
+    latency.add(bench_now_ns() - t0);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+
+  char extra[64];
+  snprintf(extra, sizeof(extra), ", \"on\": \"%s\"", on);
+  bench_report("bst", "has", queries.size(), 1, queries.size(), seconds,
+      latency, extra);
+  return found;
+}
+
+// bst_t::has() isn't const.
+struct tree_ref_t {
+  bst_t &tree;
+  bool has(const int key) const { return tree.has(key); }
+};
+
+int main(int argc, char *argv[])
+{
+  size_t size = argc > 1 ? atol(argv[1]) : 1000000;
+  std::string dir = argc > 2 ? argv[2] : "/tmp";
+  std::string text_path = dir + "/bst_snapshot_bench.txt";
+  std::string snapshot_path = dir + "/bst_snapshot_bench.snap";
+
+  std::mt19937 rng(1);
+  std::vector<int> keys(size);
+  for (auto &key : keys) {
+    key = (int)(rng() >> 1);
+  }
+  {
+    // The input format of src/main.cc, with a single case.
+    std::ofstream text(text_path);
+    text << 1 << '\n' << size << '\n';
+    for (auto key : keys) {
+      text << key << ' ';
+    }
+    text << '\n';
+  }
+
+  // Parse and insert.
+  latency_t text_latency;
+  uint64_t start = bench_now_ns();
+  bst_t tree;
+  {
+    std::ifstream in(text_path);
+    int tc, num_elem;
+    in >> tc >> num_elem;
+    for (int i = 0; i < num_elem; ++i) {
+      int key;
+      in >> key;
+      tree.insert(key);
+    }
+  }
+  bool first = tree.has(keys[0]);
+  text_latency.add(bench_now_ns() - start);
+  bench_report("bst", "startup_text", size, 1, 1,
+      (bench_now_ns() - start) * 1e-9, text_latency);
+
+  latency_t save_latency;
+  start = bench_now_ns();
+  bool saved = tree.save(snapshot_path.c_str());
+  save_latency.add(bench_now_ns() - start);
+  bench_report("bst", "save", size, 1, 1, (bench_now_ns() - start) * 1e-9,
+      save_latency);
+
+  latency_t snapshot_latency;
+  start = bench_now_ns();
+  bst_snapshot_t snapshot;
+  bool opened = snapshot.open(snapshot_path.c_str());
+  first = first && snapshot.has(keys[0]);
+  snapshot_latency.add(bench_now_ns() - start);
+  bench_report("bst", "startup_snapshot", size, 1, 1,
+      (bench_now_ns() - start) * 1e-9, snapshot_latency);
+
+  if (!saved || !opened || !first || snapshot.size() != (int64_t)size
+      || snapshot.get_height() != tree.get_height()) {
+    std::cerr << "snapshot_bench: snapshot differs from the tree"
+      << std::endl;
+  }
+
+  std::vector<int> queries(size);
+  for (size_t i = 0; i < size; ++i) {
+    queries[i] = i % 2 ? keys[rng() % size] : (int)(rng() >> 1);
+  }
+  tree_ref_t ref = {tree};
+  if (bench_has(ref, "tree", queries) != bench_has(snapshot, "snapshot",
+        queries)) {
+    std::cerr << "snapshot_bench: lookups differ" << std::endl;
+  }
+
+  remove(text_path.c_str());
+  remove(snapshot_path.c_str());
+  return 0;
+}
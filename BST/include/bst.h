@@ -2,12 +2,21 @@
  * Iterative implementation.
  * Type is integer. Not unique elements. */
 
+#pragma once
+
 #include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "task_pool.h"
 
 class bst_t
 {
 public:
   bst_t ();
+  bst_t (const bst_t&);
+  bst_t& operator=(const bst_t&);
   virtual ~bst_t ();
 
   bool insert(const int);
@@ -16,6 +25,37 @@ public:
   void print_inorder();
   
   int get_height(); // height of leaf nodes is 0
+  int64_t size();
+
+  // Set operations, e.g. to merge two key sets. The nodes of other move
+  // into this tree, and other is left empty. Keys are taken as sets: the
+  // result holds each key once. The recursion forks into tasks for
+  // n_threads threads, run by the task pool (../sched/task_pool.h).
+  // Trees not balanced yet are balanced first, see balance().
+  void unite(bst_t &other, const int n_threads = 1);
+  void intersect(bst_t &other, const int n_threads = 1);
+  void subtract(bst_t &other, const int n_threads = 1); // this - other
+
+  // Rebuild the tree as a treap in O(n), keeping each key once. The set
+  // operations keep it a treap; insert() and remove() don't.
+  void balance();
+
+  // Write the tree to path, for bst_snapshot_t to map. See bst_snapshot.h.
+  // False if it can't be written, or has over INT32_MAX nodes.
+  bool save(const char *path);
+
+  // Treap with the priority of a node hashed from its key, so nodes need
+  // no room for it. The hash is a bijection, so distinct keys never tie.
+  // pbst_t shares it.
+  static uint32_t priority(const int elem) {
+    uint32_t h = elem;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+  }
 
 private:
   /* data */
@@ -26,6 +66,7 @@ private:
   } node_t;
 
   node_t* root;
+  bool balanced; // a treap of unique keys, see balance()
 
   void destroy_tree(node_t*);
 
@@ -42,6 +83,36 @@ private:
 
     return left_height > right_height ? left_height + 1 : right_height + 1;
   }
+
+  // Without recursion, as size(): a tree of sorted inserts is as deep as
+  // it is big. The stack holds copies whose children aren't copied yet,
+  // with their originals.
+  node_t* copy(node_t *node) {
+    if (!node) {
+      return nullptr;
+    }
+
+    node_t *new_root = new node_t();
+    new_root->elem = node->elem;
+    std::vector<std::pair<node_t*, node_t*> > stack;
+    stack.push_back(std::make_pair(new_root, node));
+    while (!stack.empty()) {
+      node_t *to = stack.back().first;
+      node_t *from = stack.back().second;
+      stack.pop_back();
+      if (from->left) {
+        to->left = new node_t();
+        to->left->elem = from->left->elem;
+        stack.push_back(std::make_pair(to->left, from->left));
+      }
+      if (from->right) {
+        to->right = new node_t();
+        to->right->elem = from->right->elem;
+        stack.push_back(std::make_pair(to->right, from->right));
+      }
+    }
+    return new_root;
+  }
   
   node_t* insert(node_t *node, const int elem) {
     // Base case
@@ -116,4 +187,126 @@ private:
     }
     return node;
   }
+
+  // Whether node a goes above node b. Anything goes above an empty tree.
+  static bool above(node_t *a, node_t *b) {
+    return a && (!b || priority(a->elem) > priority(b->elem));
+  }
+
+  // Run f and g as tasks of the pool while depth is above 0.
+  template <typename F, typename G>
+  static void fork_join(const int depth, F f, G g) {
+    if (depth > 0) {
+      task_pool_t::instance().fork_join(f, g);
+    } else {
+      f();
+      g();
+    }
+  }
+
+  // Split node into the keys below key and the keys above it. Returns
+  // the node of key, detached, or nullptr.
+  node_t* split(node_t *node, const int key, node_t *&lo, node_t *&hi) {
+    if (!node) {
+      lo = hi = nullptr;
+      return nullptr;
+    }
+
+    node_t *found;
+    if (key < node->elem) {
+      found = split(node->left, key, lo, node->left);
+      hi = node;
+    } else if (key > node->elem) {
+      found = split(node->right, key, node->right, hi);
+      lo = node;
+    } else {
+      found = node;
+      lo = node->left;
+      hi = node->right;
+      node->left = node->right = nullptr;
+    }
+    return found;
+  }
+
+  // Join two treaps, where every key of lo is below every key of hi.
+  node_t* join(node_t *lo, node_t *hi) {
+    if (!lo) {
+      return hi;
+    } else if (!hi) {
+      return lo;
+    }
+
+    if (above(lo, hi)) {
+      lo->right = join(lo->right, hi);
+      return lo;
+    }
+    hi->left = join(lo, hi->left);
+    return hi;
+  }
+
+  // The root of the union is the higher of the two roots. Split the other
+  // tree by its key, and unite the halves on both sides.
+  node_t* unite(node_t *a, node_t *b, const int depth) {
+    if (!a) {
+      return b;
+    } else if (!b) {
+      return a;
+    }
+
+    if (above(b, a)) {
+      std::swap(a, b);
+    }
+    node_t *lo, *hi;
+    delete split(b, a->elem, lo, hi);
+    fork_join(depth,
+        [&]() { a->left = unite(a->left, lo, depth - 1); },
+        [&]() { a->right = unite(a->right, hi, depth - 1); });
+    return a;
+  }
+
+  node_t* intersect(node_t *a, node_t *b, const int depth) {
+    if (!a || !b) {
+      destroy_tree(a);
+      destroy_tree(b);
+      return nullptr;
+    }
+
+    if (above(b, a)) {
+      std::swap(a, b);
+    }
+    node_t *lo, *hi;
+    node_t *found = split(b, a->elem, lo, hi);
+    fork_join(depth,
+        [&]() { a->left = intersect(a->left, lo, depth - 1); },
+        [&]() { a->right = intersect(a->right, hi, depth - 1); });
+
+    if (found) {
+      delete found;
+      return a;
+    }
+    node_t *joined = join(a->left, a->right);
+    delete a;
+    return joined;
+  }
+
+  // a - b. Split a by the root of b, which is dropped from both sides.
+  node_t* subtract(node_t *a, node_t *b, const int depth) {
+    if (!a || !b) {
+      destroy_tree(b);
+      return a;
+    }
+
+    node_t *lo, *hi;
+    delete split(a, b->elem, lo, hi);
+    fork_join(depth,
+        [&]() { lo = subtract(lo, b->left, depth - 1); },
+        [&]() { hi = subtract(hi, b->right, depth - 1); });
+    delete b;
+    return join(lo, hi);
+  }
 };
+
+// Insert the num_elem sorted keys of v from idx_start by medians, so the
+// tree is as low as it gets.
+void make_minimal_tree(bst_t &bst, std::vector<int> &v,
+                       int idx_start, int num_elem);
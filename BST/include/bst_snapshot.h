@@ -0,0 +1,54 @@
+/* Read-only bst_t mapped from a file written by bst_t::save().
+ *
+ * The file is used as it is, without building a tree: opening it costs a
+ * mmap and a pass that checks every child is within the file.
+ * Nodes are stored breadth first, so the top levels of the tree share
+ * pages. Children are offsets in nodes from their parent instead of
+ * pointers, so the file means the same wherever it is mapped.
+ * Integers are in the byte order of the machine that saved the file. */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#define BST_SNAPSHOT_MAGIC "BSTSNAP"
+#define BST_SNAPSHOT_VERSION 1
+
+typedef struct bst_snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t node_size;
+  int64_t num_nodes;
+} bst_snapshot_header_t;
+
+// Root is node 0. A child is at its parent's index plus left or right,
+// and left or right is 0 if there is no such child.
+typedef struct bst_snapshot_node {
+  int32_t elem;
+  int32_t left;
+  int32_t right;
+} bst_snapshot_node_t;
+
+class bst_snapshot_t
+{
+public:
+  bst_snapshot_t ();
+  virtual ~bst_snapshot_t ();
+
+  bool open(const char *path); // false if path isn't a snapshot
+  void close();
+
+  bool has(const int) const;
+  int64_t size() const;
+  int get_height() const; // height of leaf nodes is 0, as in bst_t
+
+private:
+  void *map;
+  size_t map_size;
+  const bst_snapshot_node_t *nodes;
+  int64_t num_nodes;
+
+  bst_snapshot_t (const bst_snapshot_t&) = delete;
+  bst_snapshot_t& operator=(const bst_snapshot_t&) = delete;
+};
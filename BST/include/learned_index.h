@@ -0,0 +1,80 @@
+/* Read-mostly index of int keys, an alternative to bst_t for keys that
+ * come mostly in order, e.g. timestamps, which make bst_t a list.
+ *
+ * The keys are kept in one sorted array. A linear spline maps a key to
+ * its position in the array, within max_error positions (RadixSpline,
+ * Kipf et al., aiDM 2020). The spline points are found in one pass by
+ * the greedy spline corridor, and a radix table on the top bits of a key
+ * narrows down the spline segment. A lookup is then a binary search of
+ * 2 * max_error + 3 keys.
+ * Inserts go into a small sorted delta buffer, which is merged into the
+ * array when it is full or by merge(). Only the spline from the segment
+ * of the first delta key is rebuilt, so timestamps arriving about in
+ * order cost about the delta buffer.
+ * Keys need not be unique, as in bst_t. */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#define LEARNED_INDEX_MAX_ERROR 32
+#define LEARNED_INDEX_RADIX_BITS 18
+#define LEARNED_INDEX_DELTA_SIZE 4096
+
+class learned_index_t
+{
+public:
+  explicit learned_index_t (const int max_error = LEARNED_INDEX_MAX_ERROR,
+                            const int radix_bits = LEARNED_INDEX_RADIX_BITS,
+                            const size_t delta_size = LEARNED_INDEX_DELTA_SIZE);
+  virtual ~learned_index_t ();
+
+  // Replace the keys, given in any order.
+  void build(const std::vector<int> &keys);
+
+  bool insert(const int);
+  bool has(const int) const;
+
+  // Append the keys in [low, high] to out, in order. Return their number.
+  size_t range(const int low, const int high, std::vector<int> &out) const;
+
+  // Move the delta buffer into the array.
+  void merge();
+
+  int64_t size() const;
+  size_t get_num_segments() const; // spline segments
+  size_t memory_bytes() const;     // keys, spline, radix table and delta
+
+private:
+  typedef struct spline_point {
+    uint32_t key; // see to_unsigned()
+    double pos;
+  } spline_point_t;
+
+  int max_error;
+  int radix_bits;
+  size_t delta_size;
+
+  std::vector<int> keys;   // sorted
+  std::vector<int> delta;  // sorted, merged at delta_size keys
+
+  std::vector<spline_point_t> spline;
+  std::vector<uint32_t> radix_table; // first spline point of each prefix
+  uint32_t min_key;
+  int radix_shift;
+
+  // Order preserving, so that the spline and the radix table work on
+  // unsigned distances.
+  static uint32_t to_unsigned(const int key) {
+    return (uint32_t)key ^ 0x80000000u;
+  }
+
+  void build_spline(const size_t first);
+  void build_radix_table();
+
+  // First position of keys that is not below key, as std::lower_bound.
+  size_t lower_bound(const int key) const;
+  double predict(const uint32_t key) const;
+};
@@ -0,0 +1,225 @@
+/* Persistent binary search tree of int keys, for readers that need a
+ * consistent view of the keys while writers keep inserting and removing.
+ *
+ * An update copies the path to its key instead of changing nodes, and
+ * publishes the new root with one atomic store. A published node is
+ * never written again, so a snapshot_t, the root of one version, is read
+ * without any synchronization for as long as it is held.
+ * The tree is a treap with priorities hashed from the keys, as bst_t
+ * after balance(), so an update copies O(log n) nodes. Keys are unique.
+ *
+ * The nodes an update leaves out are retired with its version. They are
+ * reused by later updates once no snapshot of an older version is held,
+ * so updates rarely allocate. A snapshot announces its version in one of
+ * PBST_MAX_SNAPSHOTS slots, which writers scan every PBST_RECLAIM_EVERY
+ * updates. Writers are serialized by a mutex. */
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include "bst.h"
+
+#define PBST_MAX_SNAPSHOTS 64
+#define PBST_RECLAIM_EVERY 64
+#define PBST_FREE_SLOT UINT64_MAX
+
+class pbst_t
+{
+  typedef struct node {
+    int elem;
+    struct node* left;
+    struct node* right;
+  } node_t;
+
+public:
+  class snapshot_t;
+
+  pbst_t ();
+  virtual ~pbst_t (); // every snapshot must have been released
+
+  bool insert(const int); // false if the key is there already
+  bool remove(const int); // false if the key isn't there
+
+  // The latest version. Reading it takes a snapshot, see snapshot_t.
+  snapshot_t snapshot();
+  bool has(const int);
+  int64_t size(); // of the latest version, without walking it
+
+  uint64_t get_version();
+  int64_t get_allocated_nodes(); // nodes taken from new so far
+  int64_t get_retired_nodes();   // left out, not reusable yet
+
+  // An immutable version of the tree. It keeps the nodes of its version
+  // from being reused until it is destroyed, so hold it briefly.
+  class snapshot_t
+  {
+  public:
+    snapshot_t (snapshot_t&&);
+    virtual ~snapshot_t ();
+
+    bool has(const int) const;
+    int64_t size() const;   // walks the tree
+    int get_height() const; // height of leaf nodes is 0, as in bst_t
+
+    // f(key) for every key, in order.
+    template <typename F>
+    void for_each(F f) const {
+      std::vector<const node_t*> stack;
+      const node_t *iter = root;
+      while (iter || !stack.empty()) {
+        while (iter) {
+          stack.push_back(iter);
+          iter = iter->left;
+        }
+        iter = stack.back();
+        stack.pop_back();
+        f(iter->elem);
+        iter = iter->right;
+      }
+    }
+
+  private:
+    friend class pbst_t;
+    explicit snapshot_t (pbst_t*);
+    snapshot_t (const snapshot_t&) = delete;
+    snapshot_t& operator=(const snapshot_t&) = delete;
+
+    pbst_t *tree;
+    int slot; // -1 once moved from
+    const node_t *root;
+  };
+
+private:
+  // A line each, as readers write them.
+  typedef struct slot {
+    std::atomic<uint64_t> version; // PBST_FREE_SLOT if no snapshot
+    char pad[64 - sizeof(std::atomic<uint64_t>)];
+  } slot_t;
+
+  std::atomic<node_t*> root;
+  std::atomic<uint64_t> version;
+  std::atomic<int64_t> n_keys;
+  slot_t slots[PBST_MAX_SNAPSHOTS];
+
+  // Below are the writers', under the mutex.
+  std::mutex write_mutex;
+  std::vector<node_t*> pending; // left out by the update in progress
+  std::vector<std::pair<uint64_t, node_t*> > retired; // by version
+  node_t *free_nodes; // linked by left
+  int64_t allocated;
+  int updates_since_reclaim;
+
+  pbst_t (const pbst_t&) = delete;
+  pbst_t& operator=(const pbst_t&) = delete;
+
+  void publish(node_t *new_root);
+  void reclaim();
+  static void destroy_nodes(node_t *node);
+
+  node_t* allocate(const int elem) {
+    node_t *node = free_nodes;
+    if (node) {
+      free_nodes = node->left;
+    } else {
+      node = new node_t();
+      ++allocated;
+    }
+    node->elem = elem;
+    node->left = node->right = nullptr;
+    return node;
+  }
+
+  // A writable copy of a published node, which is retired.
+  node_t* copy(node_t *node) {
+    node_t *new_node = allocate(node->elem);
+    new_node->left = node->left;
+    new_node->right = node->right;
+    pending.push_back(node);
+    return new_node;
+  }
+
+  // Priorities of bst_t's treap.
+  static bool above(const node_t *a, const node_t *b) {
+    return a && (!b || bst_t::priority(a->elem) > bst_t::priority(b->elem));
+  }
+
+  // The nodes returned by the updates below are new, so they can be
+  // rotated in place. The path above them is copied on the way back.
+  node_t* insert(node_t *node, const int elem, bool &inserted) {
+    if (!node) {
+      inserted = true;
+      return allocate(elem);
+    } else if (elem == node->elem) {
+      return node;
+    }
+
+    bool go_left = elem < node->elem;
+    node_t *child = insert(go_left ? node->left : node->right, elem,
+        inserted);
+    if (!inserted) {
+      return node;
+    }
+
+    node_t *new_node = copy(node);
+    if (go_left) {
+      new_node->left = child;
+      if (above(child, new_node)) {
+        new_node->left = child->right;
+        child->right = new_node;
+        return child;
+      }
+    } else {
+      new_node->right = child;
+      if (above(child, new_node)) {
+        new_node->right = child->left;
+        child->left = new_node;
+        return child;
+      }
+    }
+    return new_node;
+  }
+
+  node_t* remove(node_t *node, const int elem, bool &removed) {
+    if (!node) {
+      return nullptr;
+    } else if (elem == node->elem) {
+      removed = true;
+      pending.push_back(node);
+      return join(node->left, node->right);
+    }
+
+    bool go_left = elem < node->elem;
+    node_t *child = remove(go_left ? node->left : node->right, elem,
+        removed);
+    if (!removed) {
+      return node;
+    }
+
+    node_t *new_node = copy(node);
+    (go_left ? new_node->left : new_node->right) = child;
+    return new_node;
+  }
+
+  // Join two treaps, where every key of lo is below every key of hi,
+  // copying the spines it goes down.
+  node_t* join(node_t *lo, node_t *hi) {
+    if (!lo) {
+      return hi;
+    } else if (!hi) {
+      return lo;
+    }
+
+    if (above(lo, hi)) {
+      node_t *new_node = copy(lo);
+      new_node->right = join(lo->right, hi);
+      return new_node;
+    }
+    node_t *new_node = copy(hi);
+    new_node->left = join(lo, hi->left);
+    return new_node;
+  }
+};
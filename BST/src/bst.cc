@@ -1,9 +1,25 @@
 #include <iostream>
 #include <climits>
+#include <vector>
 #include "bst.h"
 
 bst_t::bst_t () {
   root = nullptr;
+  balanced = true;
+}
+
+bst_t::bst_t (const bst_t &other) {
+  root = copy(other.root);
+  balanced = other.balanced;
+}
+
+bst_t& bst_t::operator=(const bst_t &other) {
+  if (this != &other) {
+    destroy_tree(root);
+    root = copy(other.root);
+    balanced = other.balanced;
+  }
+  return *this;
 }
 
 bst_t::~bst_t () {
@@ -11,16 +27,28 @@ bst_t::~bst_t () {
   // root = nullptr;
 }
 
+// Without recursion, as size().
 void bst_t::destroy_tree(node_t* node) {
+  std::vector<node_t*> stack;
   if (node) {
-    destroy_tree(node->left);
-    destroy_tree(node->right);
+    stack.push_back(node);
+  }
+  while (!stack.empty()) {
+    node = stack.back();
+    stack.pop_back();
+    if (node->left) {
+      stack.push_back(node->left);
+    }
+    if (node->right) {
+      stack.push_back(node->right);
+    }
     delete node;
   }
 }
 
 bool bst_t::insert (int elem) {
   root = insert(root, elem);
+  balanced = false;
   return true;
 }
 
@@ -46,6 +74,7 @@ bool bst_t::remove(const int elem) {
   }
 
   root = remove(root, elem);
+  balanced = false;
 
   return true;
 }
@@ -63,3 +92,44 @@ void bst_t::print_inorder() {
 int bst_t::get_height() { 
   return get_height(root);
 }
+
+// Without recursion, as a tree of sorted inserts is as deep as it is big.
+int64_t bst_t::size() {
+  int64_t count = 0;
+  std::vector<node_t*> stack;
+
+  if (root) {
+    stack.push_back(root);
+  }
+  while (!stack.empty()) {
+    node_t *node = stack.back();
+    stack.pop_back();
+    ++count;
+    if (node->left) {
+      stack.push_back(node->left);
+    }
+    if (node->right) {
+      stack.push_back(node->right);
+    }
+  }
+  return count;
+}
+
+void make_minimal_tree(bst_t &bst, std::vector<int> &v,
+                       int idx_start, int num_elem) {
+  if (num_elem == 0) {
+    return;
+  } else if (num_elem == 1) {
+    bst.insert(v[idx_start]);
+    return;
+  }
+
+  int idx_median = (idx_start + (idx_start + num_elem - 1)) / 2;
+  bst.insert(v[idx_median]);
+
+  int next_vector_size = (num_elem - 1) / 2;
+
+  make_minimal_tree(bst, v, idx_start, next_vector_size);
+  make_minimal_tree(bst, v, idx_median + 1,
+      num_elem & 1 ? next_vector_size : next_vector_size + 1);
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+#include "bst.h"
+
+// Fork the top levels of the recursion into up to 4 tasks per thread, as
+// the subtrees are not all the same size.
+static int fork_depth(const int n_threads) {
+  int depth = 0;
+  while (n_threads > 1 && (1 << depth) < 4 * n_threads) {
+    ++depth;
+  }
+  return depth;
+}
+
+void bst_t::balance() {
+  // In order, without recursion, dropping repeated keys.
+  std::vector<node_t*> nodes, stack;
+  node_t *iter = root;
+  while (iter || !stack.empty()) {
+    while (iter) {
+      stack.push_back(iter);
+      iter = iter->left;
+    }
+    iter = stack.back();
+    stack.pop_back();
+
+    node_t *next = iter->right;
+    if (!nodes.empty() && nodes.back()->elem == iter->elem) {
+      delete iter;
+    } else {
+      nodes.push_back(iter);
+    }
+    iter = next;
+  }
+
+  // Build the treap from left to right. The stack holds its right spine:
+  // a node goes below the last one above it, and takes the ones it is
+  // above as its left subtree.
+  stack.clear();
+  for (auto node : nodes) {
+    node_t *left = nullptr;
+    while (!stack.empty() && above(node, stack.back())) {
+      left = stack.back();
+      stack.pop_back();
+    }
+    node->left = left;
+    node->right = nullptr;
+    if (!stack.empty()) {
+      stack.back()->right = node;
+    }
+    stack.push_back(node);
+  }
+
+  root = stack.empty() ? nullptr : stack.front();
+  balanced = true;
+}
+
+void bst_t::unite(bst_t &other, const int n_threads) {
+  if (&other == this) {
+    balance();
+    return;
+  }
+  if (!balanced) {
+    balance();
+  }
+  if (!other.balanced) {
+    other.balance();
+  }
+
+  root = unite(root, other.root, fork_depth(n_threads));
+  other.root = nullptr;
+}
+
+void bst_t::intersect(bst_t &other, const int n_threads) {
+  if (&other == this) {
+    balance();
+    return;
+  }
+  if (!balanced) {
+    balance();
+  }
+  if (!other.balanced) {
+    other.balance();
+  }
+
+  root = intersect(root, other.root, fork_depth(n_threads));
+  other.root = nullptr;
+}
+
+void bst_t::subtract(bst_t &other, const int n_threads) {
+  if (&other == this) {
+    destroy_tree(root);
+    root = nullptr;
+    balanced = true;
+    return;
+  }
+  if (!balanced) {
+    balance();
+  }
+  if (!other.balanced) {
+    other.balance();
+  }
+
+  root = subtract(root, other.root, fork_depth(n_threads));
+  other.root = nullptr;
+}
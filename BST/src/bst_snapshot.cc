@@ -0,0 +1,194 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bst.h"
+#include "bst_snapshot.h"
+
+// Breadth first, so a node's index is its place in the queue, and the
+// indexes of its children are known when they are queued.
+bool bst_t::save(const char *path) {
+  std::vector<node_t*> queue;
+  if (root) {
+    queue.push_back(root);
+  }
+  for (size_t i = 0; i < queue.size(); ++i) {
+    if (queue[i]->left) {
+      queue.push_back(queue[i]->left);
+    }
+    if (queue[i]->right) {
+      queue.push_back(queue[i]->right);
+    }
+  }
+
+  // Children are at int32_t offsets from their parents, which are below
+  // the number of nodes. Checked before path is truncated.
+  if (queue.size() > (size_t)INT32_MAX) {
+    std::cerr << "(save) " << queue.size() << " nodes don't fit in a snapshot"
+      << std::endl;
+    return false;
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << "(save) cannot open " << path << std::endl;
+    return false;
+  }
+
+  bst_snapshot_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BST_SNAPSHOT_MAGIC, sizeof(BST_SNAPSHOT_MAGIC));
+  header.version = BST_SNAPSHOT_VERSION;
+  header.node_size = sizeof(bst_snapshot_node_t);
+  header.num_nodes = queue.size();
+  out.write((const char*)&header, sizeof(header));
+
+  // Children are queued in the same order as here.
+  std::vector<bst_snapshot_node_t> nodes;
+  nodes.reserve(queue.size());
+  int64_t next = 1;
+  for (size_t i = 0; i < queue.size(); ++i) {
+    bst_snapshot_node_t node = {queue[i]->elem, 0, 0};
+    if (queue[i]->left) {
+      node.left = next++ - i;
+    }
+    if (queue[i]->right) {
+      node.right = next++ - i;
+    }
+    nodes.push_back(node);
+  }
+  out.write((const char*)nodes.data(), nodes.size() * sizeof(nodes[0]));
+
+  if (!out) {
+    std::cerr << "(save) cannot write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bst_snapshot_t::bst_snapshot_t ()
+  : map(nullptr), map_size(0), nodes(nullptr), num_nodes(0) {
+}
+
+bst_snapshot_t::~bst_snapshot_t () {
+  close();
+}
+
+bool bst_snapshot_t::open(const char *path) {
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "(open) cannot open " << path << std::endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0
+      || (size_t)st.st_size < sizeof(bst_snapshot_header_t)) {
+    std::cerr << "(open) " << path << " is not a snapshot" << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "(open) cannot map " << path << std::endl;
+    return false;
+  }
+  map = addr;
+  map_size = st.st_size;
+
+  const bst_snapshot_header_t *header = (const bst_snapshot_header_t*)map;
+  if (memcmp(header->magic, BST_SNAPSHOT_MAGIC, sizeof(BST_SNAPSHOT_MAGIC))
+      || header->version != BST_SNAPSHOT_VERSION
+      || header->node_size != sizeof(bst_snapshot_node_t)
+      || header->num_nodes < 0
+      || header->num_nodes > (int64_t)(map_size / sizeof(bst_snapshot_node_t))
+      || map_size != sizeof(*header)
+                     + header->num_nodes * sizeof(bst_snapshot_node_t)) {
+    std::cerr << "(open) " << path << " is not a snapshot" << std::endl;
+    close();
+    return false;
+  }
+
+  // Children come after their parent and within the file, so lookups of
+  // a corrupt file neither leave the map nor loop.
+  const bst_snapshot_node_t *file_nodes =
+    (const bst_snapshot_node_t*)(header + 1);
+  for (int64_t i = 0; i < header->num_nodes; ++i) {
+    int64_t left = file_nodes[i].left;
+    int64_t right = file_nodes[i].right;
+    if (left < 0 || right < 0 || i + left >= header->num_nodes
+        || i + right >= header->num_nodes) {
+      std::cerr << "(open) " << path << " has a child of node " << i
+        << " out of the snapshot" << std::endl;
+      close();
+      return false;
+    }
+  }
+
+  num_nodes = header->num_nodes;
+  nodes = file_nodes;
+  return true;
+}
+
+void bst_snapshot_t::close() {
+  if (map) {
+    munmap(map, map_size);
+  }
+  map = nullptr;
+  map_size = 0;
+  nodes = nullptr;
+  num_nodes = 0;
+}
+
+bool bst_snapshot_t::has(const int elem) const {
+  if (num_nodes == 0) {
+    return false;
+  }
+
+  const bst_snapshot_node_t *iter = nodes;
+  while (true) {
+    if (elem < iter->elem) {
+      if (!iter->left) {
+        return false;
+      }
+      iter += iter->left;
+    } else if (elem > iter->elem) {
+      if (!iter->right) {
+        return false;
+      }
+      iter += iter->right;
+    } else {
+      return true;
+    }
+  }
+}
+
+int64_t bst_snapshot_t::size() const {
+  return num_nodes;
+}
+
+// Levels are contiguous: a level ends where the children of the one
+// before it end.
+int bst_snapshot_t::get_height() const {
+  int height = -1;
+  int64_t level_end = 0, next_end = 1;
+
+  for (int64_t i = 0; i < num_nodes; ++i) {
+    if (i == level_end) {
+      ++height;
+      level_end = next_end;
+    }
+    next_end = std::max(next_end, i + std::max(nodes[i].left,
+          nodes[i].right) + 1);
+  }
+  return height;
+}
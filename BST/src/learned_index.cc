@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <iterator>
+#include "learned_index.h"
+
+learned_index_t::learned_index_t (const int max_error, const int radix_bits,
+                                  const size_t delta_size)
+  : max_error(max_error), radix_bits(radix_bits), delta_size(delta_size),
+    min_key(0), radix_shift(0) {
+}
+
+learned_index_t::~learned_index_t () {
+}
+
+void learned_index_t::build(const std::vector<int> &keys) {
+  this->keys = keys;
+  std::sort(this->keys.begin(), this->keys.end());
+  delta.clear();
+
+  build_spline(0);
+  build_radix_table();
+}
+
+bool learned_index_t::insert(const int elem) {
+  delta.insert(std::upper_bound(delta.begin(), delta.end(), elem), elem);
+  if (delta.size() >= delta_size) {
+    merge();
+  }
+  return true;
+}
+
+bool learned_index_t::has(const int elem) const {
+  if (std::binary_search(delta.begin(), delta.end(), elem)) {
+    return true;
+  }
+
+  size_t pos = lower_bound(elem);
+  return pos < keys.size() && keys[pos] == elem;
+}
+
+size_t learned_index_t::range(const int low, const int high,
+                              std::vector<int> &out) const {
+  if (low > high) {
+    return 0;
+  }
+
+  auto keys_begin = keys.begin() + lower_bound(low);
+  auto keys_end = std::upper_bound(keys_begin, keys.end(), high);
+  auto delta_begin = std::lower_bound(delta.begin(), delta.end(), low);
+  auto delta_end = std::upper_bound(delta_begin, delta.end(), high);
+
+  size_t count = (keys_end - keys_begin) + (delta_end - delta_begin);
+  out.reserve(out.size() + count);
+  std::merge(keys_begin, keys_end, delta_begin, delta_end,
+      std::back_inserter(out));
+  return count;
+}
+
+void learned_index_t::merge() {
+  if (delta.empty()) {
+    return;
+  }
+
+  // Keys up to the first of delta keep their positions, and so do the
+  // spline points before the segment they end in. Timestamps mostly come
+  // after every key, or a little before the last.
+  size_t from = std::upper_bound(keys.begin(), keys.end(), delta.front())
+    - keys.begin();
+  std::vector<int> tail;
+  tail.reserve(keys.size() - from + delta.size());
+  std::merge(keys.begin() + from, keys.end(), delta.begin(), delta.end(),
+      std::back_inserter(tail));
+  keys.resize(from);
+  keys.insert(keys.end(), tail.begin(), tail.end());
+
+  size_t first = 0;
+  if (!spline.empty()) {
+    first = std::lower_bound(spline.begin(), spline.end(), (double)from,
+        [](const spline_point_t &p, double pos) { return p.pos < pos; })
+      - spline.begin();
+    first = std::min(first, spline.size() - 1);
+  }
+  build_spline(first);
+  delta.clear();
+
+  build_radix_table();
+}
+
+int64_t learned_index_t::size() const {
+  return keys.size() + delta.size();
+}
+
+size_t learned_index_t::get_num_segments() const {
+  return spline.size() > 1 ? spline.size() - 1 : 0;
+}
+
+size_t learned_index_t::memory_bytes() const {
+  return sizeof(*this) + keys.capacity() * sizeof(int)
+    + delta.capacity() * sizeof(int)
+    + spline.capacity() * sizeof(spline_point_t)
+    + radix_table.capacity() * sizeof(uint32_t);
+}
+
+// Greedy spline corridor: a segment from base is extended while a line
+// from base stays within max_error of every key it passes, i.e. while
+// the slope to the next key is between the smallest upper bound and the
+// largest lower bound so far. A key is at the first position it has.
+// Points before first are kept, and the corridor starts again from the
+// one before it.
+void learned_index_t::build_spline(const size_t first) {
+  spline.resize(first);
+  if (keys.empty()) {
+    return;
+  }
+
+  if (spline.empty()) {
+    spline_point_t point = {to_unsigned(keys[0]), 0};
+    spline.push_back(point);
+  }
+  spline_point_t base = spline.back();
+  spline_point_t prev = base;
+  double upper = 0, lower = 0;
+
+  for (size_t i = (size_t)base.pos + 1; i < keys.size(); ++i) {
+    if (keys[i] == keys[i - 1]) {
+      continue;
+    }
+
+    spline_point_t point = {to_unsigned(keys[i]), (double)i};
+    double dx = (double)point.key - base.key;
+    double slope = (point.pos - base.pos) / dx;
+
+    if (prev.key != base.key && (slope > upper || slope < lower)) {
+      // The key is out of the corridor: end the segment at the key
+      // before it, and start a new corridor there.
+      spline.push_back(prev);
+      base = prev;
+      dx = (double)point.key - base.key;
+      upper = (point.pos + max_error - base.pos) / dx;
+      lower = (point.pos - max_error - base.pos) / dx;
+    } else if (prev.key == base.key) {
+      upper = (point.pos + max_error - base.pos) / dx;
+      lower = (point.pos - max_error - base.pos) / dx;
+    } else {
+      upper = std::min(upper, (point.pos + max_error - base.pos) / dx);
+      lower = std::max(lower, (point.pos - max_error - base.pos) / dx);
+    }
+    prev = point;
+  }
+
+  if (prev.key != base.key) {
+    spline.push_back(prev);
+  }
+}
+
+// radix_table[p] is the first spline point whose key, less the smallest,
+// has p as its top radix_bits bits. The table ends with the number of
+// points, so that radix_table[p + 1] bounds the search from radix_table[p].
+void learned_index_t::build_radix_table() {
+  radix_table.clear();
+  if (spline.empty()) {
+    return;
+  }
+
+  min_key = spline.front().key;
+  uint32_t span = spline.back().key - min_key;
+  int span_bits = span ? 32 - __builtin_clz(span) : 0;
+  radix_shift = std::max(span_bits - radix_bits, 0);
+
+  radix_table.assign((span >> radix_shift) + 2, 0);
+  size_t prefix = 0;
+  for (size_t i = 0; i < spline.size(); ++i) {
+    size_t point_prefix = (spline[i].key - min_key) >> radix_shift;
+    while (prefix <= point_prefix) {
+      radix_table[prefix++] = i;
+    }
+  }
+  while (prefix < radix_table.size()) {
+    radix_table[prefix++] = spline.size();
+  }
+}
+
+// key is between the smallest and the largest key.
+double learned_index_t::predict(const uint32_t key) const {
+  size_t prefix = (key - min_key) >> radix_shift;
+  auto point = std::lower_bound(spline.begin() + radix_table[prefix],
+      spline.begin() + radix_table[prefix + 1], key,
+      [](const spline_point_t &p, uint32_t k) { return p.key < k; });
+
+  if (point->key == key) {
+    return point->pos;
+  }
+
+  const spline_point_t &left = *(point - 1);
+  return left.pos + (point->pos - left.pos)
+    * ((double)key - left.key) / ((double)point->key - left.key);
+}
+
+// The key is within max_error + 1 positions of the prediction, unless a
+// run of equal keys longer than max_error is next to it. Then the window
+// grows exponentially until it holds the key.
+size_t learned_index_t::lower_bound(const int elem) const {
+  if (keys.empty()) {
+    return 0;
+  }
+
+  uint32_t key = to_unsigned(elem);
+  if (key <= min_key) {
+    return 0;
+  }
+  if (key > spline.back().key) {
+    return keys.size();
+  }
+
+  int64_t n = keys.size();
+  int64_t guess = (int64_t)predict(key);
+  int64_t low = std::max(guess - max_error - 1, (int64_t)0);
+  int64_t high = std::min(guess + max_error + 2, n);
+
+  for (int64_t step = max_error + 1; low > 0 && keys[low - 1] >= elem;
+       step *= 2) {
+    high = low;
+    low = std::max(low - step, (int64_t)0);
+  }
+  for (int64_t step = max_error + 1; high < n && keys[high - 1] < elem;
+       step *= 2) {
+    low = high;
+    high = std::min(high + step, n);
+  }
+
+  return std::lower_bound(keys.begin() + low, keys.begin() + high, elem)
+    - keys.begin();
+}
@@ -3,28 +3,6 @@
 
 #include "bst.h"
 
-void make_minimal_tree(bst_t &bst, std::vector<int> &v,
-                       int idx_start, int num_elem) {
-  if (num_elem == 0) {
-    return;
-  } else if (num_elem == 1) {
-    bst.insert(v[idx_start]);
-    return;
-  }
-
-  int idx_median = (idx_start + (idx_start + num_elem - 1)) / 2;
-  bst.insert(v[idx_median]);
-
-  int next_vector_size = (num_elem - 1) / 2;
-
-  make_minimal_tree(bst, v, idx_start, next_vector_size);
-  make_minimal_tree(bst, v, idx_median + 1,
-      num_elem & 1 ? next_vector_size : next_vector_size + 1);
-
-  return;
-}
-
-
 int main(void)
 {
   int tc;
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include "pbst.h"
+
+pbst_t::pbst_t ()
+  : root(nullptr), version(0), n_keys(0), free_nodes(nullptr),
+    allocated(0), updates_since_reclaim(0) {
+  for (auto &slot : slots) {
+    slot.version.store(PBST_FREE_SLOT);
+  }
+}
+
+pbst_t::~pbst_t () {
+  destroy_nodes(root.load());
+  for (auto &entry : retired) {
+    delete entry.second;
+  }
+  while (free_nodes) {
+    node_t *next = free_nodes->left;
+    delete free_nodes;
+    free_nodes = next;
+  }
+}
+
+// Without recursion, as in bst_t::size().
+void pbst_t::destroy_nodes(node_t *node) {
+  std::vector<node_t*> stack;
+  if (node) {
+    stack.push_back(node);
+  }
+  while (!stack.empty()) {
+    node = stack.back();
+    stack.pop_back();
+    if (node->left) {
+      stack.push_back(node->left);
+    }
+    if (node->right) {
+      stack.push_back(node->right);
+    }
+    delete node;
+  }
+}
+
+bool pbst_t::insert(const int elem) {
+  std::lock_guard<std::mutex> lock(write_mutex);
+  bool inserted = false;
+  node_t *new_root = insert(root.load(std::memory_order_relaxed), elem,
+      inserted);
+  if (inserted) {
+    n_keys.fetch_add(1, std::memory_order_relaxed);
+    publish(new_root);
+  }
+  return inserted;
+}
+
+bool pbst_t::remove(const int elem) {
+  std::lock_guard<std::mutex> lock(write_mutex);
+  bool removed = false;
+  node_t *new_root = remove(root.load(std::memory_order_relaxed), elem,
+      removed);
+  if (removed) {
+    n_keys.fetch_sub(1, std::memory_order_relaxed);
+    publish(new_root);
+  }
+  return removed;
+}
+
+pbst_t::snapshot_t pbst_t::snapshot() {
+  return snapshot_t(this);
+}
+
+bool pbst_t::has(const int elem) {
+  return snapshot().has(elem);
+}
+
+int64_t pbst_t::size() {
+  return n_keys.load(std::memory_order_relaxed);
+}
+
+uint64_t pbst_t::get_version() {
+  return version.load();
+}
+
+int64_t pbst_t::get_allocated_nodes() {
+  std::lock_guard<std::mutex> lock(write_mutex);
+  return allocated;
+}
+
+int64_t pbst_t::get_retired_nodes() {
+  std::lock_guard<std::mutex> lock(write_mutex);
+  return retired.size();
+}
+
+// The nodes left out are unreachable from the new version on, so they
+// are retired with its number.
+void pbst_t::publish(node_t *new_root) {
+  uint64_t new_version = version.load(std::memory_order_relaxed) + 1;
+  root.store(new_root, std::memory_order_release);
+  version.store(new_version, std::memory_order_release);
+
+  for (auto node : pending) {
+    retired.push_back(std::make_pair(new_version, node));
+  }
+  pending.clear();
+
+  if (++updates_since_reclaim >= PBST_RECLAIM_EVERY) {
+    updates_since_reclaim = 0;
+    reclaim();
+  }
+}
+
+// A snapshot announced version v holds a root of version v or later, so
+// nodes retired with v or before are unreachable from it. The fence pairs
+// with the one in snapshot_t(): either the scan sees a new snapshot's
+// slot, or the snapshot sees the new root.
+void pbst_t::reclaim() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  uint64_t oldest = version.load(std::memory_order_relaxed);
+  for (auto &slot : slots) {
+    oldest = std::min(oldest, slot.version.load(std::memory_order_acquire));
+  }
+
+  size_t n = 0;
+  while (n < retired.size() && retired[n].first <= oldest) {
+    node_t *node = retired[n++].second;
+    node->left = free_nodes;
+    free_nodes = node;
+  }
+  retired.erase(retired.begin(), retired.begin() + n);
+}
+
+// The version is read before the root, and announced before the root is
+// read, so the root is of the announced version or later.
+pbst_t::snapshot_t::snapshot_t (pbst_t *tree) : tree(tree) {
+  uint64_t announced = tree->version.load(std::memory_order_acquire);
+  size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+  for (int i = 0; ; ++i) {
+    slot = (start + i) % PBST_MAX_SNAPSHOTS;
+    uint64_t expected = PBST_FREE_SLOT;
+    if (tree->slots[slot].version.compare_exchange_strong(expected,
+          announced)) {
+      break;
+    }
+    if (i % PBST_MAX_SNAPSHOTS == PBST_MAX_SNAPSHOTS - 1) {
+      std::this_thread::yield();
+      announced = tree->version.load(std::memory_order_acquire);
+    }
+  }
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  root = tree->root.load(std::memory_order_acquire);
+}
+
+pbst_t::snapshot_t::snapshot_t (snapshot_t &&other)
+  : tree(other.tree), slot(other.slot), root(other.root) {
+  other.slot = -1;
+}
+
+pbst_t::snapshot_t::~snapshot_t () {
+  if (slot >= 0) {
+    tree->slots[slot].version.store(PBST_FREE_SLOT,
+        std::memory_order_release);
+  }
+}
+
+bool pbst_t::snapshot_t::has(const int elem) const {
+  const node_t *iter = root;
+  while (iter) {
+    if (elem < iter->elem) {
+      iter = iter->left;
+    } else if (elem > iter->elem) {
+      iter = iter->right;
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+int64_t pbst_t::snapshot_t::size() const {
+  int64_t count = 0;
+  for_each([&](int) { ++count; });
+  return count;
+}
+
+int pbst_t::snapshot_t::get_height() const {
+  // Breadth first, a level at a time.
+  std::vector<const node_t*> level, next;
+  if (root) {
+    level.push_back(root);
+  }
+  int height = -1;
+  while (!level.empty()) {
+    ++height;
+    next.clear();
+    for (auto node : level) {
+      if (node->left) {
+        next.push_back(node->left);
+      }
+      if (node->right) {
+        next.push_back(node->right);
+      }
+    }
+    level.swap(next);
+  }
+  return height;
+}
@@ -0,0 +1,83 @@
+// Helpers shared by the benchmark drivers of every module.
+//
+// Every result is printed to stdout as one JSON object per line:
+//  {"module": ..., "op": ..., "size": ..., "threads": ...,
+//   "ops": ..., "seconds": ..., "ops_per_sec": ...,
+//   "p50_ns": ..., "p90_ns": ..., "p99_ns": ..., "p999_ns": ..., "max_ns": ...}
+// Parameters of a driver of its own are appended to the object.
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+
+static inline uint64_t bench_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Latency samples of an operation, in nanoseconds.
+class latency_t
+{
+public:
+  latency_t () : sorted(true) {}
+
+  void reserve(size_t n) {
+    samples.reserve(n);
+  }
+
+  void add(uint64_t ns) {
+    samples.push_back(ns);
+    sorted = false;
+  }
+
+  // Merge the samples of another thread.
+  void merge(const latency_t& other) {
+    samples.insert(samples.end(), other.samples.begin(), other.samples.end());
+    sorted = false;
+  }
+
+  size_t count() {
+    return samples.size();
+  }
+
+  // p is in [0, 1].
+  uint64_t percentile(double p) {
+    if(samples.empty()) {
+      return 0;
+    }
+    if(!sorted) {
+      std::sort(samples.begin(), samples.end());
+      sorted = true;
+    }
+    size_t idx = (size_t)(p * (samples.size() - 1) + 0.5);
+    return samples[idx];
+  }
+
+private:
+  std::vector<uint64_t> samples;
+  bool sorted;
+};
+
+// extra is appended to the object as is, e.g. ", \"buckets\": 64".
+static inline void bench_report(const char* module, const char* op,
+                                size_t size, int threads,
+                                size_t ops, double seconds,
+                                latency_t& latency, const char* extra = "") {
+  printf("{\"module\": \"%s\", \"op\": \"%s\", \"size\": %zu, \"threads\": %d, "
+         "\"ops\": %zu, \"seconds\": %.6f, \"ops_per_sec\": %.1f, "
+         "\"p50_ns\": %lu, \"p90_ns\": %lu, \"p99_ns\": %lu, "
+         "\"p999_ns\": %lu, \"max_ns\": %lu%s}\n",
+         module, op, size, threads, ops, seconds,
+         seconds > 0 ? ops / seconds : 0.0,
+         (unsigned long)latency.percentile(0.5),
+         (unsigned long)latency.percentile(0.9),
+         (unsigned long)latency.percentile(0.99),
+         (unsigned long)latency.percentile(0.999),
+         (unsigned long)latency.percentile(1.0),
+         extra);
+  fflush(stdout);
+}
@@ -0,0 +1,157 @@
+// Latency and throughput of ConcurrentList push_back, erase and traversal.
+// push_back/erase runs on a plain pool, then on a pool with a partition per
+// NUMA node. With more nodes than the machine has, threads are spread over
+// the partitions by set_thread_node(), which tries the partitioning without
+// the placement.
+//
+// Usage: list_bench [ops per thread] [max threads] [max traverse size]
+//                   [numa nodes, -1 for the machine's]
+// Built with -DLIST_STATS, it dumps the counters of the pool to stderr.
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <pthread.h>
+#include "ConcurrentList.h"
+#include "bench.h"
+
+typedef ConcurrentList<int> list_t;
+
+// Each thread appends a batch of nodes, then erases them newest first,
+// as src/main.cc does.
+#define BATCH 8
+
+struct thread_arg_t {
+  long tid;
+  list_t* list;
+  list_t::NodePool* pool;
+  int node; // -1 for the node the thread runs on
+  long n_ops;
+  latency_t push_latency;
+  latency_t erase_latency;
+};
+
+static void* thread_main(void* args) {
+  thread_arg_t* arg = (thread_arg_t*)args;
+  list_t::node_t* nodes[BATCH];
+
+  arg->push_latency.reserve(arg->n_ops);
+  arg->erase_latency.reserve(arg->n_ops);
+  if(arg->node >= 0)
+    arg->pool->set_thread_node(arg->node);
+
+  for(long i = 0; i < arg->n_ops; i += BATCH) {
+    for(int k = 0; k < BATCH; k++) {
+      uint64_t start = bench_now_ns();
+      nodes[k] = arg->list->push_back(arg->tid * 1000000 + k);
+      arg->push_latency.add(bench_now_ns() - start);
+    }
+    for(int k = BATCH - 1; k >= 0; k--) {
+      uint64_t start = bench_now_ns();
+      arg->list->erase(nodes[k]);
+      arg->erase_latency.add(bench_now_ns() - start);
+    }
+  }
+
+  return nullptr;
+}
+
+// push_back and erase are timed together, as every node is erased
+// by the thread that appended it.
+static void bench_push_erase(int n_threads, long n_ops, int numa_nodes) {
+  int n_nodes = numa_nodes == NUMA_AUTO
+    ? list_t::NodePool::numa_online_nodes() : std::max(numa_nodes, 1);
+  bool simulated = n_nodes > list_t::NodePool::numa_online_nodes();
+  list_t::NodePool pool(INDEX_ARRAY_SIZE * n_nodes, numa_nodes);
+  list_t list(&pool);
+
+  pthread_t* threads = new pthread_t[n_threads];
+  thread_arg_t* args = new thread_arg_t[n_threads];
+
+  uint64_t start = bench_now_ns();
+  for(int i = 0; i < n_threads; i++) {
+    args[i].tid = i + 1;
+    args[i].list = &list;
+    args[i].pool = &pool;
+    args[i].node = simulated ? i % n_nodes : -1;
+    args[i].n_ops = n_ops;
+    pthread_create(&threads[i], nullptr, thread_main, &args[i]);
+  }
+  for(int i = 0; i < n_threads; i++)
+    pthread_join(threads[i], nullptr);
+  double seconds = (bench_now_ns() - start) * 1e-9;
+
+  latency_t push_latency, erase_latency;
+  for(int i = 0; i < n_threads; i++) {
+    push_latency.merge(args[i].push_latency);
+    erase_latency.merge(args[i].erase_latency);
+  }
+
+#ifdef LIST_STATS
+  fprintf(stderr, "push_back/erase, %d threads:\n", n_threads);
+  list.dump_stats(stderr);
+#endif
+
+  char extra[64];
+  snprintf(extra, sizeof(extra), ", \"numa_parts\": %d%s",
+      pool.get_num_numa_parts(), simulated ? ", \"simulated\": true" : "");
+  size_t n_total = push_latency.count();
+  bench_report("concurrent_list", "push_back", BATCH, n_threads,
+      n_total, seconds, push_latency, extra);
+  bench_report("concurrent_list", "erase", BATCH, n_threads,
+      n_total, seconds, erase_latency, extra);
+
+  delete[] args;
+  delete[] threads;
+}
+
+// A walk over a list of size live nodes by one thread.
+static void bench_traverse(size_t size) {
+  // Enough segment arrays for the nodes, plus one spare round.
+  size_t s_size = (size_t)0x1 << (3 * (LEVEL - 1));
+  size_t n_seg_arrays = (size / s_size + 2 * INDEX_ARRAY_SIZE - 1)
+    / INDEX_ARRAY_SIZE * INDEX_ARRAY_SIZE;
+  list_t::NodePool pool(n_seg_arrays);
+  list_t list(&pool);
+
+  for(size_t i = 0; i < size; i++)
+    list.push_back(i);
+
+  size_t n_walks = 1 + 4000000 / size;
+  latency_t latency;
+  latency.reserve(n_walks);
+
+  size_t visited = 0;
+  uint64_t start = bench_now_ns();
+  for(size_t i = 0; i < n_walks; i++) {
+    uint64_t t = bench_now_ns();
+    visited += list.snapshot_size();
+    latency.add(bench_now_ns() - t);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+
+  if(visited != n_walks * size)
+    fprintf(stderr, "traverse: visited %zu nodes, expected %zu\n",
+        visited, n_walks * size);
+
+  bench_report("concurrent_list", "traverse", size, 1,
+      n_walks, seconds, latency);
+}
+
+int main(int argc, char* argv[])
+{
+  long n_ops = argc > 1 ? atol(argv[1]) : 100000;
+  int max_threads = argc > 2 ? atoi(argv[2]) : 64;
+  size_t max_size = argc > 3 ? atol(argv[3]) : 4096;
+  int numa_nodes = argc > 4 ? atoi(argv[4]) : NUMA_AUTO;
+
+  for(int n_threads = 1; n_threads <= max_threads; n_threads *= 4) {
+    bench_push_erase(n_threads, n_ops, NUMA_OFF);
+    bench_push_erase(n_threads, n_ops, numa_nodes);
+  }
+
+  for(size_t size = 64; size <= max_size; size *= 8)
+    bench_traverse(size);
+
+  return 0;
+}
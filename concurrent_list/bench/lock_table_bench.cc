@@ -0,0 +1,150 @@
+// Throughput of LockTable under Zipfian resource access, with blocked
+// acquires parked and polling. A lock is held for hold us, asleep as a
+// transaction waiting for I/O would be, so the CPU time of the process is
+// mostly that of the waiters.
+// size in the result is the number of buckets.
+//
+// Usage: lock_table_bench [threads] [buckets] [resources] [ops per thread]
+//                         [zipf theta] [exclusive %] [hold us]
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include <pthread.h>
+#include <unistd.h>
+#include "LockTable.h"
+#include "bench.h"
+
+// Zipfian generator of Gray et al., "Quickly Generating Billion-Record
+// Synthetic Databases", SIGMOD 1994.
+struct zipf_t {
+  uint32_t n;
+  double theta, alpha, zetan, eta;
+};
+
+static void zipf_init(zipf_t* z, uint32_t n, double theta) {
+  double zeta2 = 0;
+  z->n = n;
+  z->theta = theta;
+  z->zetan = 0;
+  for(uint32_t i = 1; i <= n; i++)
+    z->zetan += 1.0 / pow((double)i, theta);
+  for(uint32_t i = 1; i <= 2; i++)
+    zeta2 += 1.0 / pow((double)i, theta);
+  z->alpha = 1.0 / (1.0 - theta);
+  z->eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / z->zetan);
+}
+
+static uint32_t zipf_next(const zipf_t* z, unsigned int* seed) {
+  double u = (double)rand_r(seed) / RAND_MAX;
+  double uz = u * z->zetan;
+  if(uz < 1.0)
+    return 0;
+  if(uz < 1.0 + pow(0.5, z->theta))
+    return 1;
+  uint32_t r = (uint32_t)(z->n * pow(z->eta * u - z->eta + 1.0, z->alpha));
+  return r < z->n ? r : z->n - 1;
+}
+
+struct thread_arg_t {
+  long tid;
+  LockTable* table;
+  const zipf_t* zipf;
+  long n_ops;
+  int exclusive_pct;
+  int hold_us;
+  unsigned int seed;
+  latency_t latency;
+};
+
+static void* thread_main(void* args) {
+  thread_arg_t* arg = (thread_arg_t*)args;
+  arg->latency.reserve(arg->n_ops);
+
+  for(long i = 0; i < arg->n_ops; i++) {
+    uint32_t rid = zipf_next(arg->zipf, &arg->seed);
+    enum LockTable::lock_mode mode =
+      rand_r(&arg->seed) % 100 < arg->exclusive_pct
+      ? LockTable::EXCLUSIVE : LockTable::SHARED;
+
+    uint64_t txn_id = (uint64_t)arg->tid << 32 | i;
+    uint64_t start = bench_now_ns();
+    LockTable::lock_t* lock = arg->table->acquire(txn_id, rid, mode);
+    if(arg->hold_us)
+      usleep(arg->hold_us);
+    arg->table->release(lock);
+    arg->latency.add(bench_now_ns() - start);
+  }
+
+  return nullptr;
+}
+
+static double cpu_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_table(bool park, int n_threads, size_t n_buckets,
+                        uint32_t n_resources, long n_ops, double theta,
+                        int exclusive_pct, int hold_us) {
+  zipf_t zipf;
+  zipf_init(&zipf, n_resources, theta);
+
+  LockTable table(n_buckets, park);
+
+  pthread_t* threads = new pthread_t[n_threads];
+  thread_arg_t* args = new thread_arg_t[n_threads];
+
+  double cpu_start = cpu_seconds();
+  uint64_t start = bench_now_ns();
+  for(int i = 0; i < n_threads; i++) {
+    args[i].tid = i;
+    args[i].table = &table;
+    args[i].zipf = &zipf;
+    args[i].n_ops = n_ops;
+    args[i].exclusive_pct = exclusive_pct;
+    args[i].hold_us = hold_us;
+    args[i].seed = i + 1;
+    pthread_create(&threads[i], nullptr, thread_main, &args[i]);
+  }
+
+  for(int i = 0; i < n_threads; i++)
+    pthread_join(threads[i], nullptr);
+  double seconds = (bench_now_ns() - start) * 1e-9;
+  double cpu = cpu_seconds() - cpu_start;
+
+  latency_t latency;
+  for(int i = 0; i < n_threads; i++)
+    latency.merge(args[i].latency);
+
+  char extra[192];
+  snprintf(extra, sizeof(extra),
+      ", \"resources\": %u, \"theta\": %.2f, \"exclusive_pct\": %d"
+      ", \"hold_us\": %d, \"wait\": \"%s\", \"cpu_seconds\": %.3f",
+      n_resources, theta, exclusive_pct, hold_us, park ? "park" : "poll",
+      cpu);
+  bench_report("concurrent_list", "lock_acquire_release", n_buckets,
+      n_threads, latency.count(), seconds, latency, extra);
+
+  delete[] args;
+  delete[] threads;
+}
+
+int main(int argc, char* argv[])
+{
+  int n_threads = argc > 1 ? atoi(argv[1]) : 8;
+  size_t n_buckets = argc > 2 ? atol(argv[2]) : 64;
+  uint32_t n_resources = argc > 3 ? atol(argv[3]) : 1000000;
+  long n_ops = argc > 4 ? atol(argv[4]) : 100000;
+  double theta = argc > 5 ? atof(argv[5]) : 0.99;
+  int exclusive_pct = argc > 6 ? atoi(argv[6]) : 20;
+  int hold_us = argc > 7 ? atoi(argv[7]) : 0;
+
+  bench_table(false, n_threads, n_buckets, n_resources, n_ops, theta,
+      exclusive_pct, hold_us);
+  bench_table(true, n_threads, n_buckets, n_resources, n_ops, theta,
+      exclusive_pct, hold_us);
+
+  return 0;
+}
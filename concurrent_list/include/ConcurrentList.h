@@ -5,15 +5,32 @@
 #include <cstddef>
 #include <cassert>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <iterator>
+#include <vector>
 #include <pthread.h>
+#include <climits>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 /* #define OBSOLETE (1ULL << 63)
  * #define IS_OBSOLETE(ptr) (((intptr_t)(ptr) & OBSOLETE) != 0)
  * #define SET_OBSOLETE(ptr) ((intptr_t)(ptr) |= OBSOLETE) */
 
+// The next pointer of an OBSOLETE node is marked before the node is
+// unlinked. A marked pointer never changes again, so the successor can't
+// be unlinked through the node at the same time, which would leave the
+// successor linked after its bit in BVector was cleared.
+#define UNLINK_BIT 0x1ULL
+#define HAS_UNLINK_BIT(ptr) (((intptr_t)(ptr) & UNLINK_BIT) != 0)
+#define GET_NODE(ptr) ((node_t*)((intptr_t)(ptr) & ~UNLINK_BIT))
+
 /****** These are for index array ******/
-#define LEVEL (4) // Level of segment array
-#define INDEX_ARRAY_SIZE 8 // It must be 8, because of flip_and_test function
+#define LEVEL (4) // Level of segment array. Any value from 1 works.
+#define INDEX_ARRAY_SIZE 8 // Default size. It must be a multiple of 8.
 // s_size = (size_t) 0x1 << (3 * (LEVEL -1));
 // Level 4:
 //        1
@@ -24,6 +41,13 @@
 // Each segment array has 512 locks.
 // If a size of IndexArray is 8, then this array has 512 * 8 = 4096 locks.
 
+// BVector keeps a bit per node that is set while the node is linked.
+// The bits of a segment array form a tree of 64-bit words: a bit of
+// level k + 1 is set while its word of level k is not zero. The top word
+// is summarized by a bit per segment array in the BVector summary.
+#define BVECTOR_BITS 64
+#define BVECTOR_MAX_LEVELS 11 // 64^11 > 2^64
+
 #define INVALID_BIT (1ULL<<63)
 #define SET_INVALID_BIT(ptr) ((intptr_t)(ptr) | INVALID_BIT)
 #define RESET_INVALID_BIT(ptr) ((intptr_t)(ptr) & ~INVALID_BIT)
@@ -31,12 +55,105 @@
 
 #define HAS_INVALID_BIT(ptr) (((intptr_t)(ptr) & INVALID_BIT) != 0)
 
-
-
+// Number of slots a thread takes from the pool at once.
+// It must divide the size of a segment array.
+#define ALLOC_BLOCK_SIZE 16
+
+// State of a segment array in an allocation round.
+#define SEG_DECIDING 0
+#define SEG_USE 1
+#define SEG_SKIP 2
+#define SEG_STATE(round, status) (((round) << 2) | (status))
+#define SEG_ROUND(state) ((state) >> 2)
+#define SEG_STATUS(state) ((state) & 0x3)
+
+/****** These are for NUMA placement ******/
+// A pool built with numa_nodes splits its segment arrays into a partition
+// per NUMA node. Each partition is placed on its node's memory, and a
+// thread takes its slots from the partition of the node it runs on.
+// NUMA_AUTO takes the number of nodes of the machine.
+#define NUMA_OFF 0
+#define NUMA_AUTO (-1)
+#define MAX_NUMA_NODES 64
+
+/****** These are for memory layout ******/
+#define CACHE_LINE_SIZE 64
+
+// Nodes are aligned, and so padded, to the ALIGN template argument
+// of ConcurrentList. By uncommenting below #define, its default becomes
+// a whole cache line. A node of ConcurrentList<int> is 24 bytes, so
+// without padding two or three neighbouring nodes of a segment array
+// share one line even when different threads own them.
+// #define PADDED_NODE
+
+#define MAX_ALIGN(a, b) ((a) > (b) ? (a) : (b))
+
+#ifdef PADDED_NODE
+#define DEFAULT_NODE_ALIGN CACHE_LINE_SIZE
+#else
+#define DEFAULT_NODE_ALIGN alignof(void*)
+#endif
+
+/****** These are for waiting on erase() ******/
+// A thread waiting for another to erase a node spins on the node's status
+// for WAIT_SPINS reads, then parks on a futex. Parked threads are counted
+// in slots hashed from the node's address, so erase() makes a system
+// call only while a thread waits on a node of its slot.
+#define WAIT_SPINS 1024
+#define PARK_SLOTS_BITS 8
+#define PARK_SLOTS (1 << PARK_SLOTS_BITS)
+
+typedef struct park_slot {
+  uint32_t seq;       // bumped by erase() to wake the slot's threads
+  uint32_t n_waiters;
+  char pad[CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+} park_slot_t;
+
+/****** These are for statistics ******/
+// By uncommenting below #define, or building with -DLIST_STATS,
+// each thread counts contention events in the lists of a pool.
+// See NodePool::get_stats() and dump_stats().
+// Without it the counters are compiled out.
+// #define LIST_STATS
+
+#ifdef LIST_STATS
+#define LIST_STAT(stats, field, n) ((stats)->field += (n))
+#else
+#define LIST_STAT(stats, field, n) ((void)0)
+#endif
+
+// Counters of a thread, or their sum over the threads.
+typedef struct list_stats {
+  uint64_t walks;         // next_pointer_update() calls
+  uint64_t walk_nodes;    // nodes visited by them
+  uint64_t walk_max;      // nodes visited by the longest one
+  uint64_t walk_retries;  // failed CASes on pred->next, restarting a walk
+  uint64_t unlinks;       // OBSOLETE nodes unlinked
+  uint64_t getnext_spins; // getNext() iterations waiting for a link
+  uint64_t alloc_blocks;  // blocks of slots taken from the pool
+  uint64_t alloc_waits;   // yields waiting for a segment array decision
+  uint64_t alloc_cas_failures; // failed CASes deciding or skipping arrays
+  uint64_t skipped_slots; // slots of rounds their array was skipped for
+  uint64_t seg_skips;     // segment array rounds decided to be skipped
+  uint64_t seg_reinits;   // segment arrays recycled
+} list_stats_t;
+
+
+// T is the element stored inline in each node.
+// It is copy constructed by push_back() and destructed when its segment
+// array is recycled, so a reader may look at an OBSOLETE node's elem
+// until then.
+template <typename T, size_t ALIGN = DEFAULT_NODE_ALIGN>
 class ConcurrentList
 {
 public:
   // Types definition
+  // Where is the location of OBSOLETE?
+  // A variable, or a bit of next pointer?
+  // If the second option is correct, we must have pred and curr node
+  // to mark the OBSOLETE bit.
+  // WAIT is a node whose thread waits for nodes before it, e.g. a lock
+  // request. The list itself treats it as ACTIVE.
   enum status {INVALID, HEAD, ACTIVE, WAIT, OBSOLETE};
 
   typedef struct MetaData {
@@ -44,91 +161,403 @@ public:
     int s_idx; // segment array idx
   } MetaData;
 
-  struct node {
+  // The union keeps elem unconstructed until push_back().
+  // Nodes live in raw memory of the pool and are never constructed
+  // as a whole. Any status but INVALID and HEAD means elem is alive.
+  struct alignas(MAX_ALIGN(ALIGN, MAX_ALIGN(alignof(T), alignof(void*))))
+  node {
     struct node* next;
     enum status status;
-    int elem;
     MetaData metaData;
+    union {
+      T elem;
+    };
+
+    node() {}
+    ~node() {}
   };
   typedef struct node node_t;
 
+  // Preallocated segment arrays the nodes are taken from.
+  // Several lists can share one pool, e.g. the buckets of a hash table.
+  class NodePool;
+
 
   // Constructor and destructor
-  ConcurrentList ();
-  virtual ~ConcurrentList ();
+  // The list allocates its nodes from a pool of its own.
+  ConcurrentList () {
+    init_head();
+
+    pool = new NodePool();
+    owns_pool = true;
+    pool->attach(this);
+  }
+
+  // The list allocates its nodes from a shared pool, which must outlive it.
+  explicit ConcurrentList (NodePool* pool) {
+    init_head();
+
+    this->pool = pool;
+    owns_pool = false;
+    pool->attach(this);
+  }
+
+  virtual ~ConcurrentList () {
+    pool->detach(this);
+    if(owns_pool)
+      delete pool;
+    free(head);
+  }
 
   // Methods
   // Insert a value
-  node_t* push_back(int);
+  // First, update tail node using atomic instruction.
+  // Second, connect old_tail to new tail.
+  // Third, call next_pointer_update() to skip OBSOLETE nodes.
+  node_t* push_back(const T& elem) {
+    // node_t* new_node = new node_t();
+    node_t* new_node = pool->allocate_node();
+
+    // checking initialization of new_node
+    assert(new_node->next == nullptr);
+    assert(new_node->status == INVALID);
+
+    new (&new_node->elem) T(elem);
+    new_node->status = ACTIVE;
+
+    // It's okay to add new_node to the tail whose status is OBSOLETE.
+    // next_pointer_update() will connect ACTIVE node and new_node.
+    // Counted before it is linked: see iterator.
+    __sync_fetch_and_add(&n_linked, 1);
+    node_t* old_tail = __sync_lock_test_and_set(&tail, new_node);
+    old_tail->next = new_node;
+    __sync_fetch_and_add(&n_size, 1); // increase counter
+    __sync_synchronize();
+    next_pointer_update();
+    __sync_synchronize();
+
+    return new_node;
+  }
 
   // Update next pointer of all nodes in the list
-  void next_pointer_update();
+  //
+  // When two adjacent nodes are concurrently deleted,
+  // lost update problem can occur.
+  //
+  // Make sure that a physically deleted node (added to free list)
+  // is not on the list for recycling the node in another list of a hash table.
+  //
+  // Lost update is prevented by marking curr's next pointer first.
+  // See UNLINK_BIT.
+  void next_pointer_update() {
+    node_t *pred = nullptr, *curr = nullptr, *succ = nullptr;
+
+    // Unlinked nodes are not recycled while we may hold them.
+    pool->enter_walk();
+    uint64_t n_nodes = 0;
+
+retry:
+    while(true) {
+      pred = head;
+      curr = getNext(pred);
+      if(!curr) break;
+
+      while(true) {
+        n_nodes++;
+        succ = getNext(curr);
+        if(!succ) goto done;
+
+        while(curr->status == OBSOLETE) {
+          succ = GET_NODE(__sync_fetch_and_or((intptr_t*)&curr->next,
+                UNLINK_BIT));
+          if(! __sync_bool_compare_and_swap(&pred->next, curr, succ)) {
+            LIST_STAT(pool->thread_stats(), walk_retries, 1);
+            goto retry;
+          }
+
+          // new
+          // if(!succ) return;
+
+          __sync_fetch_and_sub(&n_linked, 1);
+          pool->BVector_flip_and_test(curr->metaData);
+          LIST_STAT(pool->thread_stats(), unlinks, 1);
+
+          n_nodes++;
+          curr = succ;
+          succ = getNext(curr);
+          if(!succ) goto done;
+        }
+
+        // new
+        // if(!succ) return;
+
+        pred = curr;
+        curr = succ;
+      }
+    }
+
+done:
+#ifdef LIST_STATS
+    list_stats_t* stats = pool->thread_stats();
+    stats->walks++;
+    stats->walk_nodes += n_nodes;
+    if(n_nodes > stats->walk_max)
+      stats->walk_max = n_nodes;
+#endif
+    pool->exit_walk();
+  }
 
   // Lazy deletion. This method just changes a node's status to OBSOLETE
-  void erase(node_t*);
+  //
+  // Don't worry about race condition.
+  // Plural threads never get a same node
+  // because threads can access nodes which they inserted to the list.
+  void erase(node_t* node) {
+    node->status = OBSOLETE;
+    __sync_synchronize();
+    __sync_fetch_and_sub(&n_size, 1); // decrease counter
+
+    // BVector_flip_and_test(node->metaData);
+
+    // After the barrier: see prepare_wait().
+    pool->unpark(node);
+  }
+
+  // Waiting for another thread to erase a node, e.g. a conflicting lock,
+  // without polling. In two steps, so that node has to be kept from being
+  // recycled only during the first, e.g. by the iterator that reached it.
+  //
+  // prepare_wait() spins a while for the erase. If it doesn't come, the
+  // thread is counted in node's park slot. It returns false if node was
+  // erased meanwhile, and then there is nothing to wait for.
+  // wait() parks until a node of the slot is erased. That may be another
+  // node, so check again after it.
+  typedef struct wait_ticket {
+    park_slot_t* slot;
+    uint32_t seq;
+  } wait_ticket_t;
+
+  bool prepare_wait(node_t* node, wait_ticket_t* ticket) {
+    for(int i = 0; i < WAIT_SPINS; i++) {
+      if(__atomic_load_n(&node->status, __ATOMIC_ACQUIRE) == OBSOLETE)
+        return false;
+    }
+
+    // Either erase() sees the waiter after its barrier,
+    // or the waiter sees OBSOLETE after the fetch_and_add.
+    ticket->slot = pool->park_slot(node);
+    __sync_fetch_and_add(&ticket->slot->n_waiters, 1);
+    ticket->seq = __atomic_load_n(&ticket->slot->seq, __ATOMIC_ACQUIRE);
+    if(__atomic_load_n(&node->status, __ATOMIC_ACQUIRE) == OBSOLETE) {
+      __sync_fetch_and_sub(&ticket->slot->n_waiters, 1);
+      return false;
+    }
+    return true;
+  }
+
+  void wait(wait_ticket_t* ticket) {
+    park_slot_t* slot = ticket->slot;
+    while(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) == ticket->seq)
+      syscall(SYS_futex, &slot->seq, FUTEX_WAIT_PRIVATE, ticket->seq,
+          nullptr, nullptr, 0);
+    __sync_fetch_and_sub(&slot->n_waiters, 1);
+  }
 
   // This method is used for safe iteration of list.
-  node_t* getNext(node_t*);
+  // return nullptr if current node is the last
+  //
+  //  If node->next == NULL, then node should be list->tail.
+  //  If node != list->tail, it means that another Tx is
+  // updating this lock list.
+  //  The while loop will end when node->next has value.
+  //
+  // Nodes reached by getNext() may be recycled once they are unlinked,
+  // so walk with it only while no other thread appends or unlinks.
+  // Use the iterator otherwise.
+  node_t* getNext(node_t* node) {
+    uint64_t spins = 0;
+    while(node->next == nullptr && node != tail) {
+      __sync_synchronize();
+      spins++;
+    }
+    if(spins)
+      LIST_STAT(pool->thread_stats(), getnext_spins, spins);
+
+    return GET_NODE(node->next);
+  }
 
   // return head
-  node_t* getHead();
+  node_t* getHead() {
+    return head;
+  }
+
+  // Forward iterator over the nodes which are not OBSOLETE.
+  //
+  // Unlike getNext(), it never waits for an insert in progress:
+  // a node whose next pointer is not set yet ends the iteration,
+  // and so does the node that was the tail at begin().
+  // As that node may be unlinked meanwhile, the walk also ends after as
+  // many nodes as were linked at begin(), so its cost is bounded by the
+  // length of the list when it began. Nodes appended after begin() are
+  // visited only in place of nodes unlinked during the walk.
+  // Until every copy of an iterator is destructed, unlinked nodes
+  // are not recycled, so don't keep one long.
+  class iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T* pointer;
+    typedef T& reference;
+
+    iterator () : node(nullptr), last(nullptr), remaining(0), pool(nullptr) {}
+
+    iterator (const iterator& other)
+      : node(other.node), last(other.last), remaining(other.remaining),
+        pool(other.pool) {
+      if(pool)
+        pool->enter_walk();
+    }
+
+    iterator& operator=(const iterator& other) {
+      if(other.pool)
+        other.pool->enter_walk();
+      if(pool)
+        pool->exit_walk();
+      node = other.node;
+      last = other.last;
+      remaining = other.remaining;
+      pool = other.pool;
+      return *this;
+    }
+
+    ~iterator () {
+      if(pool)
+        pool->exit_walk();
+    }
+
+    T& operator*() const { return node->elem; }
+    T* operator->() const { return &node->elem; }
+
+    // The node, e.g. to be erased.
+    node_t* get_node() const { return node; }
+
+    iterator& operator++() {
+      node = node == last || --remaining == 0
+        ? nullptr : skip_obsolete(GET_NODE(node->next));
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator==(const iterator& other) const { return node == other.node; }
+    bool operator!=(const iterator& other) const { return node != other.node; }
+
+  private:
+    friend class ConcurrentList;
+
+    node_t* node;
+    node_t* last; // tail at begin()
+    size_t remaining; // nodes left to visit of those linked at begin()
+    NodePool* pool; // nullptr for end()
+
+    explicit iterator (ConcurrentList* list) : pool(list->pool) {
+      pool->enter_walk();
+
+      // Nodes up to last were counted before last was the tail.
+      last = list->tail;
+      __sync_synchronize();
+      remaining = list->n_linked;
+
+      node = last == list->head || remaining == 0
+        ? nullptr : skip_obsolete(GET_NODE(list->head->next));
+    }
+
+    node_t* skip_obsolete(node_t* it) {
+      while(it && it->status == OBSOLETE) {
+        if(it == last || --remaining == 0)
+          return nullptr;
+        it = GET_NODE(it->next);
+      }
+      return it;
+    }
+  };
 
-  size_t size();
-  bool empty();
+  iterator begin() {
+    return iterator(this);
+  }
+
+  iterator end() {
+    return iterator();
+  }
+
+  // Number of nodes which are not OBSOLETE, counted by a walk of
+  // the iterator. Unlike size(), nodes erased but not yet unlinked
+  // are never counted. It costs a walk of the list, but never waits.
+  size_t snapshot_size() {
+    size_t count = 0;
+    for(iterator it = begin(); it != end(); ++it)
+      count++;
+    return count;
+  }
+
+  size_t size() {
+    return n_size;
+  }
+
+  bool empty() {
+    return n_size == 0;
+  }
+
+  // Counters of the pool, shared with the other lists of a shared pool.
+  list_stats_t get_stats() {
+    return pool->get_stats();
+  }
+
+  void dump_stats(FILE* out = stderr) {
+    pool->dump_stats(out);
+  }
 
 private:
   /* data */
-  size_t n_size;
-
+  // Every thread touches head, tail, n_size, n_linked and the pool's
+  // next_s_idx. All but head are written by atomics on each push_back,
+  // so each of them is followed by padding up to a full cache line.
   node_t* head;
-  node_t* tail;
-
-  // Below is for IndexArray
-  typedef struct IndexArray {
-      /* data */
-    size_t i_size;  // Size of index array.
-    size_t s_size;  // Size of segment array.
-
-    /* size_t head;
-     * size_t tail; */
-    size_t last_used_i_idx;
-    size_t next_s_idx;
-    
-    ConcurrentList::node_t** indexArray;
-    char* BVector;
-    int BVector_size;
-
-    pthread_t deAllocator;
-    pthread_mutex_t deallocator_cond_mutex;
-    pthread_cond_t deallocator_cond;
-    bool deallocator_finished;
-    bool deallocator_sleeping;
-  } IndexArray;
-
-  IndexArray IA;
+  char pad_head[CACHE_LINE_SIZE - sizeof(node_t*)];
 
-  void initIndexArray();
-  void destroyIndexArray();
+  node_t* tail;
+  char pad_tail[CACHE_LINE_SIZE - sizeof(node_t*)];
 
-  node_t* allocate_new_array(int i);
+  size_t n_size;
+  char pad_size[CACHE_LINE_SIZE - sizeof(size_t)];
 
-  ConcurrentList::node_t* allocate_node();
+  // Nodes appended and not unlinked yet, as in-flight appends are.
+  size_t n_linked;
+  char pad_linked[CACHE_LINE_SIZE - sizeof(size_t)];
 
-  void doubleIndexArray();
+  NodePool* pool;
+  bool owns_pool;
 
-  bool is_new_allocation_needed();
+  void init_head() {
+    n_size = 0;
+    n_linked = 0;
+    // don't allocate it from the pool
+    head = NodePool::alloc_cache_aligned(1);
 
-  void BVector_turn_on_bits(int);
-  void BVector_turn_on_bits_recur(int);
-  void BVector_turn_on_bits_check();
-  void BVector_flip_and_test(MetaData);
+    // checking initialization of new_node
+    assert(head->next == nullptr);
+    assert(head->status == INVALID);
 
-public:
-  // Deallocate OBSOLETEd nodes
-  void reinit_seg_array(int);
-  void* lazy_deAllocate(void*);
+    head->status = HEAD; // Dummy head
 
-  void BVector_turn_off_bits_check();
-  void BVector_turn_off_bits_check_by_array(int);
-  void BVector_turn_off_bits_check_by_array_recur(int);
+    tail = head;
+  }
 };
+
+#include "NodePool.h"
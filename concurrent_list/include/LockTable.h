@@ -0,0 +1,75 @@
+// Lock table of the lock manager in the paper:
+//  A Scalable Lock Manager for Multicores, Hyungsoo Jung, et al.
+//
+// Resource IDs are hashed into a fixed number of buckets.
+// Each bucket is a ConcurrentList, and all buckets take their nodes
+// from one shared NodePool.
+#pragma once
+
+#include <cstdint>
+#include "ConcurrentList.h"
+
+// The OBSOLETE tail of every bucket and every lock being held keep
+// their segment arrays from being recycled. The pool has a segment array
+// per bucket plus this many, so some array is always free to recycle
+// while fewer locks than this are held.
+#define LOCK_TABLE_SPARE_SEG_ARRAYS 64
+
+class LockTable
+{
+public:
+  enum lock_mode {SHARED, EXCLUSIVE};
+
+  // Stored inline in the bucket's node, so a conflict check reads
+  // the request without another cache miss.
+  typedef struct lock_request {
+    uint64_t txn_id;
+    uint32_t rid;
+    enum lock_mode mode;
+  } lock_request_t;
+
+  typedef ConcurrentList<lock_request_t> bucket_t;
+  typedef bucket_t::node_t lock_t;
+
+  // Constructor and destructor
+  // A blocked acquire parks until the conflicting lock is released.
+  // With park false, it polls the bucket instead.
+  explicit LockTable (size_t n_buckets, bool park = true);
+  virtual ~LockTable ();
+
+  // Methods
+  // Append a lock request on rid and wait until no lock appended before it
+  // conflicts. The request is WAIT meanwhile. Return the granted lock.
+  lock_t* acquire(uint64_t txn_id, uint32_t rid, enum lock_mode mode);
+
+  // Same as acquire, but withdraw the request and return nullptr
+  // instead of waiting.
+  lock_t* try_acquire(uint64_t txn_id, uint32_t rid, enum lock_mode mode);
+
+  // Release a lock returned by acquire or try_acquire.
+  void release(lock_t*);
+
+  size_t get_num_buckets();
+
+private:
+  /* data */
+  bucket_t::NodePool pool;
+
+  size_t n_buckets;
+  bucket_t** buckets;
+  bool park;
+
+  bucket_t* get_bucket(uint32_t rid);
+
+  enum check_result {GRANTED, CONFLICT, UNDECIDED, WAITING};
+
+  // RAW pattern: the request has already been written to the bucket,
+  // so read every lock before it and look for a conflicting one.
+  // The scan never waits. It is UNDECIDED if an insert in progress
+  // before the request hides the rest of the bucket.
+  // With a ticket, a conflict is WAITING once prepare_wait() on the
+  // conflicting lock has registered the thread, or CONFLICT if the lock
+  // was released meanwhile.
+  enum check_result check_conflict(bucket_t*, lock_t*,
+                                   bucket_t::wait_ticket_t* ticket);
+};
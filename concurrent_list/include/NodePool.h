@@ -0,0 +1,904 @@
+// Node pool of ConcurrentList.
+// Included at the end of ConcurrentList.h.
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "ConcurrentList.h"
+
+#define DBG_PREALLOC false
+#define DBG_DEALLOC false
+
+#define SLEEP_DELAY 1000000
+
+
+template <typename T, size_t ALIGN>
+class ConcurrentList<T, ALIGN>::NodePool
+{
+public:
+  // n_seg_arrays segment arrays of 8^(LEVEL-1) nodes each.
+  // A node that stays linked keeps its segment array from being recycled,
+  // so a pool shared by many lists needs more segment arrays than lists.
+  //
+  // With numa_nodes, or NUMA_AUTO, the segment arrays are split into a
+  // partition per node. Each partition gets INDEX_ARRAY_SIZE arrays at
+  // least, so pass n_seg_arrays for every node. See set_thread_node().
+  //
+  // Each pool takes a pthread key for the caches of its threads, so at
+  // most PTHREAD_KEYS_MAX pools, less the keys taken otherwise, exist at
+  // once. Beyond that the constructor aborts.
+  explicit NodePool (size_t n_seg_arrays = INDEX_ARRAY_SIZE,
+                     int numa_nodes = NUMA_OFF) {
+    assert(n_seg_arrays > 0 && n_seg_arrays % 8 == 0);
+    assert(((size_t)1 << (3 * (LEVEL - 1))) % ALLOC_BLOCK_SIZE == 0);
+    if(pthread_key_create(&cache_key, release_cache_at_exit)) {
+      fprintf(stderr, "(NodePool) no pthread key left for the pool\n");
+      abort();
+    }
+    initIndexArray(n_seg_arrays, numa_nodes);
+
+    void* ptr = nullptr;
+    if(posix_memalign(&ptr, CACHE_LINE_SIZE, PARK_SLOTS * sizeof(park_slot_t)))
+      fprintf(stderr, "allocation error\n");
+    park_slots = (park_slot_t*)ptr;
+    memset(park_slots, 0, PARK_SLOTS * sizeof(park_slot_t));
+  }
+
+  // Threads other than the caller must have exited or released their caches.
+  virtual ~NodePool () {
+    pthread_key_delete(cache_key);
+    for(alloc_cache_t* cache = caches; cache; ) {
+      alloc_cache_t* next = cache->next_cache;
+      free(cache);
+      cache = next;
+    }
+    destroyIndexArray();
+    free(park_slots);
+  }
+
+  // Register a list whose nodes come from this pool.
+  // An allocation that waits for a segment array to be recycled
+  // unlinks OBSOLETE nodes of every registered list.
+  // Not thread safe: attach all lists before using them concurrently.
+  void attach(ConcurrentList* list) {
+    lists.push_back(list);
+  }
+
+  void detach(ConcurrentList* list) {
+    lists.erase(std::remove(lists.begin(), lists.end(), list), lists.end());
+  }
+
+  // Slots are handed out to threads in blocks of ALLOC_BLOCK_SIZE,
+  // so next_s_idx is touched once per block instead of once per node.
+  // The cache is per thread and per pool. See release_thread_cache()
+  // for a thread that stops using the pool.
+  node_t* allocate_node() {
+    alloc_cache_t* cache = get_thread_cache();
+
+    while(true) {
+      if(cache->next == cache->end) {
+        cache->part = thread_part(cache);
+        cache->next = __sync_fetch_and_add(&IA.parts[cache->part].next_s_idx,
+            ALLOC_BLOCK_SIZE);
+        cache->end = cache->next + ALLOC_BLOCK_SIZE;
+        LIST_STAT(&cache->stats, alloc_blocks, 1);
+      }
+
+      node_t* node = claim_slot(cache->part, cache->next);
+      if(node) {
+        cache->next++;
+        return node;
+      }
+
+      // A block never spans two segment arrays,
+      // so the rest of it is in the skipped round as well.
+      LIST_STAT(&cache->stats, skipped_slots, cache->end - cache->next);
+      cache->next = cache->end;
+    }
+  }
+
+  // Give back the rest of the calling thread's block of slots.
+  // Done automatically when the thread exits.
+  // They are marked as unlinked, otherwise their segment array
+  // would never be recycled.
+  // The thread must not be walking a list of the pool.
+  void release_thread_cache() {
+    alloc_cache_t* cache = (alloc_cache_t*)pthread_getspecific(cache_key);
+    if(!cache)
+      return;
+
+    for(; cache->next != cache->end; cache->next++) {
+      node_t* node = claim_slot(cache->part, cache->next);
+      if(!node)
+        break;
+      BVector_flip_and_test(node->metaData);
+    }
+
+    pthread_setspecific(cache_key, nullptr);
+    __sync_synchronize();
+    cache->in_use = 0;
+  }
+
+  // A walk of a list holds unlinked nodes until it ends.
+  // It announces the epoch it began in, and a segment array is not
+  // recycled while a walk that began before its last node was unlinked
+  // is running. See decide_seg_array().
+  // Walks nest, e.g. an iterator copied.
+  void enter_walk() {
+    alloc_cache_t* cache = get_thread_cache();
+    if(cache->walk_depth++ == 0) {
+      cache->walk_epoch = IA.epoch;
+      __sync_synchronize();
+    }
+  }
+
+  void exit_walk() {
+    alloc_cache_t* cache = get_thread_cache();
+    if(--cache->walk_depth == 0) {
+      __sync_synchronize();
+      cache->walk_epoch = 0;
+    }
+  }
+
+  // Take the calling thread's slots from the partition of NUMA node
+  // rather than of the node it runs on, e.g. for a thread the kernel may
+  // move, or to try partitions on a machine with fewer nodes.
+  // A negative node goes back to the node the thread runs on.
+  void set_thread_node(int node) {
+    get_thread_cache()->node = node;
+  }
+
+  // Number of partitions. 1 without NUMA placement.
+  int get_num_numa_parts() {
+    return IA.n_parts;
+  }
+
+  // Number of NUMA nodes of the machine, 1 if unknown.
+  static int numa_online_nodes() {
+    FILE* f = fopen("/sys/devices/system/node/online", "r");
+    if(!f)
+      return 1;
+
+    // A list of ranges, e.g. "0-1" or "0,2-3". The last number is the
+    // highest node.
+    int n = 0, last = 0;
+    char c;
+    while(fscanf(f, "%d", &n) == 1) {
+      last = n;
+      if(fscanf(f, "%c", &c) != 1)
+        break;
+    }
+    fclose(f);
+    return last + 1;
+  }
+
+  // Set cpu_node[cpu] to the NUMA node of each of the n_cpus CPUs, from
+  // the CPU lists of the nodes, e.g. "0-3,8-11". Unlisted CPUs stay 0.
+  static void numa_cpu_nodes(int* cpu_node, int n_cpus) {
+    for(int cpu = 0; cpu < n_cpus; cpu++)
+      cpu_node[cpu] = 0;
+
+    int n_nodes = numa_online_nodes();
+    for(int node = 0; node < n_nodes; node++) {
+      char path[64];
+      snprintf(path, sizeof(path),
+          "/sys/devices/system/node/node%d/cpulist", node);
+      FILE* f = fopen(path, "r");
+      if(!f)
+        continue;
+
+      int first, last;
+      char c = ',';
+      while(c == ',' && fscanf(f, "%d", &first) == 1) {
+        last = first;
+        if(fscanf(f, "%c", &c) == 1 && c == '-') {
+          if(fscanf(f, "%d", &last) != 1)
+            break;
+          if(fscanf(f, "%c", &c) != 1)
+            c = '\n';
+        }
+        for(int cpu = first; cpu <= last && cpu < n_cpus; cpu++)
+          if(cpu >= 0)
+            cpu_node[cpu] = node;
+      }
+      fclose(f);
+    }
+  }
+
+  // Slot of the threads waiting for node to be erased.
+  // Fibonacci hashing, as nodes are sizeof(node_t) apart.
+  park_slot_t* park_slot(node_t* node) {
+    return &park_slots[((uintptr_t)node * 0x9E3779B97F4A7C15ULL)
+      >> (64 - PARK_SLOTS_BITS)];
+  }
+
+  // Wake the threads waiting on node's slot, if any.
+  void unpark(node_t* node) {
+    park_slot_t* slot = park_slot(node);
+    if(__atomic_load_n(&slot->n_waiters, __ATOMIC_RELAXED) == 0)
+      return;
+
+    __sync_fetch_and_add(&slot->seq, 1);
+    syscall(SYS_futex, &slot->seq, FUTEX_WAKE_PRIVATE, INT_MAX,
+        nullptr, nullptr, 0);
+  }
+
+  // Counters of the calling thread. See LIST_STATS.
+  list_stats_t* thread_stats() {
+    return &get_thread_cache()->stats;
+  }
+
+  // Sum of the counters of every thread that used the pool,
+  // including threads that exited. Threads still running may be
+  // counting meanwhile, so the sum is not a snapshot.
+  list_stats_t get_stats() {
+    list_stats_t sum;
+    memset(&sum, 0, sizeof(sum));
+
+    for(alloc_cache_t* cache = caches; cache; cache = cache->next_cache) {
+      const list_stats_t& s = cache->stats;
+      sum.walks += s.walks;
+      sum.walk_nodes += s.walk_nodes;
+      sum.walk_max = std::max(sum.walk_max, s.walk_max);
+      sum.walk_retries += s.walk_retries;
+      sum.unlinks += s.unlinks;
+      sum.getnext_spins += s.getnext_spins;
+      sum.alloc_blocks += s.alloc_blocks;
+      sum.alloc_waits += s.alloc_waits;
+      sum.alloc_cas_failures += s.alloc_cas_failures;
+      sum.skipped_slots += s.skipped_slots;
+      sum.seg_skips += s.seg_skips;
+      sum.seg_reinits += s.seg_reinits;
+    }
+
+    return sum;
+  }
+
+  // Not thread safe: call it while no thread uses the pool.
+  void reset_stats() {
+    for(alloc_cache_t* cache = caches; cache; cache = cache->next_cache)
+      memset(&cache->stats, 0, sizeof(cache->stats));
+  }
+
+  void dump_stats(FILE* out = stderr) {
+#ifdef LIST_STATS
+    list_stats_t s = get_stats();
+    fprintf(out, "walks              %lu\n", (unsigned long)s.walks);
+    fprintf(out, "walk_nodes         %lu (%.1f per walk)\n",
+        (unsigned long)s.walk_nodes,
+        s.walks ? (double)s.walk_nodes / s.walks : 0.0);
+    fprintf(out, "walk_max           %lu\n", (unsigned long)s.walk_max);
+    fprintf(out, "walk_retries       %lu\n", (unsigned long)s.walk_retries);
+    fprintf(out, "unlinks            %lu\n", (unsigned long)s.unlinks);
+    fprintf(out, "getnext_spins      %lu\n", (unsigned long)s.getnext_spins);
+    fprintf(out, "alloc_blocks       %lu\n", (unsigned long)s.alloc_blocks);
+    fprintf(out, "alloc_waits        %lu\n", (unsigned long)s.alloc_waits);
+    fprintf(out, "alloc_cas_failures %lu\n",
+        (unsigned long)s.alloc_cas_failures);
+    fprintf(out, "skipped_slots      %lu\n", (unsigned long)s.skipped_slots);
+    fprintf(out, "seg_skips          %lu\n", (unsigned long)s.seg_skips);
+    fprintf(out, "seg_reinits        %lu\n", (unsigned long)s.seg_reinits);
+#else
+    fprintf(out, "statistics are compiled out. See LIST_STATS.\n");
+#endif
+  }
+
+  // Zeroed nodes starting at a cache line boundary.
+  // calloc only guarantees 16 bytes, which would make a padded node
+  // straddle two lines.
+  static node_t* alloc_cache_aligned(size_t n) {
+    void* ptr = nullptr;
+    size_t align = alignof(node_t) > CACHE_LINE_SIZE
+      ? alignof(node_t) : CACHE_LINE_SIZE;
+    if(posix_memalign(&ptr, align, n * sizeof(node_t)))
+      return nullptr;
+    memset(ptr, 0, n * sizeof(node_t));
+    return (node_t*)ptr;
+  }
+
+  // Called when a node is unlinked from its list.
+  // Clear the node's bit, and the bits above it whose words become zero.
+  // Only one thread sees a word become zero, so only one thread goes up.
+  void BVector_flip_and_test(MetaData metaData) {
+    uint64_t* bits = IA.BVector + metaData.i_idx * IA.BVector_seg_words;
+    size_t pos = metaData.s_idx;
+
+    for(int k = 0; k < IA.BVector_levels; k++) {
+      uint64_t mask = 1ULL << (pos % BVECTOR_BITS);
+      uint64_t* word = bits + IA.BVector_level_offset[k] + pos / BVECTOR_BITS;
+      if((__sync_fetch_and_and(word, ~mask) & ~mask) != 0)
+        return;
+      pos /= BVECTOR_BITS;
+    }
+
+    // Every node of the segment array is unlinked.
+    size_t i = metaData.i_idx;
+    IA.seg_clear_epoch[i] = __sync_fetch_and_add(&IA.epoch, 1);
+    __sync_fetch_and_and(&IA.BVector_summary[i / BVECTOR_BITS],
+        ~(1ULL << (i % BVECTOR_BITS)));
+  }
+
+  // True if every node of the ith segment array is unlinked.
+  bool BVector_is_clear(size_t i) {
+    return (IA.BVector_summary[i / BVECTOR_BITS]
+        & (1ULL << (i % BVECTOR_BITS))) == 0;
+  }
+
+  // The first segment array from the ith, circularly, whose nodes are
+  // all unlinked. Return i_size if there is none.
+  size_t BVector_find_clear(size_t i) {
+    return BVector_find_clear(i, 0, IA.i_size);
+  }
+
+  // Same, circularly within the n segment arrays from first, e.g. a
+  // partition. Return first + n if there is none.
+  size_t BVector_find_clear(size_t i, size_t first, size_t n) {
+    size_t j = BVector_find_clear_in(i, first + n);
+    if(j != first + n)
+      return j;
+    j = BVector_find_clear_in(first, i);
+    return j == i ? first + n : j;
+  }
+
+  // The first segment array in [from, to) whose nodes are all unlinked,
+  // by a ctz scan of the summary. Return to if there is none.
+  size_t BVector_find_clear_in(size_t from, size_t to) {
+    for(size_t w = from / BVECTOR_BITS; w * BVECTOR_BITS < to; w++) {
+      uint64_t clear = ~IA.BVector_summary[w];
+      if(w == from / BVECTOR_BITS)
+        clear &= ~0ULL << (from % BVECTOR_BITS);
+      if(clear) {
+        size_t j = w * BVECTOR_BITS + __builtin_ctzll(clear);
+        return j < to ? j : to;
+      }
+    }
+    return to;
+  }
+
+  // Deallocate OBSOLETEd nodes
+  // Elements are destructed here, not in erase(), because readers
+  // may still look at an OBSOLETE node until it is unlinked.
+  void reinit_seg_array(int i) {
+    BVector_turn_on_bits(i);
+    for(size_t k = 0; k < IA.s_size; k++) {
+      node_t* node = &IA.indexArray[i][k];
+      node->next = nullptr;
+      if(node->status != INVALID)
+        node->elem.~T();
+      node->status = INVALID;
+    }
+  }
+
+  void* lazy_deAllocate(void*) {
+    if(DBG_DEALLOC)
+      printf("deallocator\n");
+
+    while(true) {
+      IA.deallocator_sleeping = false;
+
+      help_unlink();
+      __sync_synchronize();
+
+      // Do not modify head. Stop right before head.
+      for(size_t i = 0; i < IA.i_size; i++) {
+        if(!BVector_is_clear(i) || GET_ADR(IA.indexArray[i]) == 0)
+          continue;
+
+        if(DBG_DEALLOC)
+          printf("Reinitializing segment array idx %ld.\n", i);
+
+        // Reinitialize deallocated array
+        reinit_seg_array(i);
+      }
+
+      if(IA.deallocator_finished == true) {
+        break;
+      }
+      IA.deallocator_sleeping = true;
+      usleep(SLEEP_DELAY);
+    }
+
+
+    if(DBG_PREALLOC) {
+      printf("finish deallocator\n");
+      printf("IndexArray:\n");
+      for(size_t i = 0; i < IA.i_size; i++) {
+        printf("%lx\n", (intptr_t)IA.indexArray[i]);
+      }
+    }
+
+    return nullptr;
+  }
+
+  // check whether every bits on
+  void BVector_turn_on_bits_check() {
+    for(size_t i = 0; i < IA.i_size; i++) {
+      assert(!BVector_is_clear(i));
+      uint64_t* bits = IA.BVector + i * IA.BVector_seg_words;
+      for(size_t b = 0; b < IA.s_size; b++)
+        assert(bits[b / BVECTOR_BITS] & (1ULL << (b % BVECTOR_BITS)));
+    }
+  }
+
+  // check whether every bits off
+  void BVector_turn_off_bits_check() {
+    for(size_t i = 0; i < IA.i_size; i++) {
+      BVector_turn_off_bits_check_by_array(i);
+    }
+  }
+
+  void BVector_turn_off_bits_check_by_array(int idx) {
+    assert(BVector_is_clear(idx));
+    uint64_t* bits = IA.BVector + idx * IA.BVector_seg_words;
+    for(size_t w = 0; w < IA.BVector_seg_words; w++)
+      assert(bits[w] == 0);
+  }
+
+private:
+  // The n segment arrays from first, on NUMA node node.
+  // next_s_idx counts the slots handed out in them.
+  typedef struct numa_part {
+    size_t next_s_idx;
+    size_t first;
+    size_t n;
+    int node;
+    char pad[CACHE_LINE_SIZE - 3 * sizeof(size_t) - sizeof(int)];
+  } numa_part_t;
+
+  typedef struct IndexArray {
+      /* data */
+    numa_part_t* parts; // a line each
+    int n_parts;
+    int* cpu_node; // NUMA node of each CPU, with more than one part
+    int n_cpus;
+
+    // Only grows. See enter_walk().
+    size_t epoch;
+    char pad_epoch[CACHE_LINE_SIZE - sizeof(size_t)];
+
+    // Below are read-mostly.
+    size_t i_size;  // Size of index array.
+    size_t s_size;  // Size of segment array.
+
+    /* size_t head;
+     * size_t tail; */
+    size_t last_used_i_idx;
+
+    node_t** indexArray;
+
+    // Per segment array. See claim_slot().
+    size_t* seg_state;      // SEG_STATE(last decided round, status)
+    size_t* seg_used_round; // last round the array was recycled for
+    size_t* seg_clear_epoch; // epoch its last node was unlinked in
+
+    // See BVECTOR_BITS.
+    uint64_t* BVector;         // BVector_seg_words per segment array
+    uint64_t* BVector_summary; // bit per segment array
+    size_t BVector_seg_words;  // rounded up to a cache line
+    size_t BVector_level_offset[BVECTOR_MAX_LEVELS];
+    int BVector_levels;
+
+    pthread_t deAllocator;
+    pthread_mutex_t deallocator_cond_mutex;
+    pthread_cond_t deallocator_cond;
+    bool deallocator_finished;
+    bool deallocator_sleeping;
+  } IndexArray;
+
+  IndexArray IA;
+
+  // Per thread state: the block of slots [next, end) taken by the thread,
+  // and its walk. The pool keeps them all in a list, where the cache of
+  // a thread that exited is left to be reused.
+  typedef struct alloc_cache {
+    NodePool* pool; // see release_cache_at_exit()
+    int part;       // partition of the block
+    int node;       // see set_thread_node(), -1 if not set
+    size_t next;
+    size_t end;
+    volatile size_t walk_epoch; // 0 while not walking
+    int walk_depth;
+    int in_use;
+    struct alloc_cache* next_cache;
+    list_stats_t stats; // kept when the cache is reused
+  } alloc_cache_t;
+
+  pthread_key_t cache_key;
+  alloc_cache_t* caches; // of every thread that used the pool
+
+  std::vector<ConcurrentList*> lists;
+
+  park_slot_t* park_slots; // PARK_SLOTS of them, shared by the lists
+
+  void initIndexArray(size_t n_seg_arrays, int numa_nodes) {
+    // Calculate index array size and segment array size
+    IA.i_size = n_seg_arrays;
+
+    IA.s_size = (size_t) 0x1 << (3 * (LEVEL - 1));
+
+    initBVector();
+    initParts(numa_nodes);
+
+    IA.indexArray = (node_t**)calloc(IA.i_size, sizeof(node_t*));
+
+    for(size_t i = 0; i < IA.i_size; i++) {
+      IA.indexArray[i] = (node_t*)INVALID_BIT;
+    }
+
+    IA.last_used_i_idx = 0;
+
+    IA.seg_state = (size_t*)calloc(IA.i_size, sizeof(size_t));
+    IA.seg_used_round = (size_t*)calloc(IA.i_size, sizeof(size_t));
+    IA.seg_clear_epoch = (size_t*)calloc(IA.i_size, sizeof(size_t));
+
+    IA.epoch = 1;
+    caches = nullptr;
+
+    // allocate all arrays. They are used in round 0.
+    for(int k = 0; k < IA.n_parts; k++) {
+      for(size_t i = IA.parts[k].first;
+          i < IA.parts[k].first + IA.parts[k].n; i++) {
+        IA.indexArray[i] = allocate_new_array(i,
+            IA.n_parts > 1 ? IA.parts[k].node : -1);
+        BVector_turn_on_bits(i);
+        IA.seg_state[i] = SEG_STATE(0, SEG_USE);
+      }
+    }
+    // BVector_turn_on_bits_check();
+
+    // Run deeallocator
+    /* IA.deallocator_finished = false;
+     * IA.deallocator_sleeping = false;
+     * pthread_mutex_init(&IA.deallocator_cond_mutex, nullptr);
+     * pthread_cond_init(&IA.deallocator_cond, nullptr);
+     * pthread_create(&IA.deAllocator, nullptr, wrap_deallocate, this); */
+  }
+
+  void destroyIndexArray() {
+    // finish deallocator
+  /*   pthread_mutex_lock(&IA.deallocator_cond_mutex);
+   *   IA.deallocator_finished = true;
+   *   pthread_cond_signal(&IA.deallocator_cond);
+   *   pthread_mutex_unlock(&IA.deallocator_cond_mutex);
+   *
+   *   pthread_join(IA.deAllocator, nullptr); */
+
+    // deallocate
+    for(size_t i = 0; i < IA.i_size; i++) {
+      node_t* ptr = (node_t*)GET_ADR(IA.indexArray[i]);
+      if(ptr != nullptr) {
+        for(size_t k = 0; k < IA.s_size; k++)
+          if(ptr[k].status != INVALID)
+            ptr[k].elem.~T();
+        free(ptr);
+      }
+    }
+
+    free(IA.indexArray);
+
+    free(IA.seg_state);
+    free(IA.seg_used_round);
+    free(IA.seg_clear_epoch);
+
+    free(IA.BVector);
+    free(IA.BVector_summary);
+    free(IA.parts);
+    free(IA.cpu_node);
+  }
+
+  // Split the segment arrays into a partition per NUMA node, or a single
+  // one. A partition gets INDEX_ARRAY_SIZE arrays at least, as a pool.
+  void initParts(int numa_nodes) {
+    int n = numa_nodes == NUMA_AUTO ? numa_online_nodes() : numa_nodes;
+    if(n > (int)(IA.i_size / INDEX_ARRAY_SIZE))
+      n = IA.i_size / INDEX_ARRAY_SIZE;
+    if(n > MAX_NUMA_NODES)
+      n = MAX_NUMA_NODES;
+    if(n < 1)
+      n = 1;
+
+    void* ptr = nullptr;
+    if(posix_memalign(&ptr, CACHE_LINE_SIZE, n * sizeof(numa_part_t)))
+      fprintf(stderr, "allocation error\n");
+    IA.parts = (numa_part_t*)ptr;
+    IA.n_parts = n;
+
+    for(int k = 0; k < n; k++) {
+      IA.parts[k].next_s_idx = 0;
+      IA.parts[k].first = IA.i_size * k / n;
+      IA.parts[k].n = IA.i_size * (k + 1) / n - IA.parts[k].first;
+      IA.parts[k].node = k;
+    }
+
+    // For thread_part(), which only gets the CPU.
+    IA.cpu_node = nullptr;
+    IA.n_cpus = 0;
+    if(n > 1) {
+      IA.n_cpus = sysconf(_SC_NPROCESSORS_CONF);
+      if(IA.n_cpus < 1)
+        IA.n_cpus = 1;
+      IA.cpu_node = (int*)malloc(IA.n_cpus * sizeof(int));
+      if(IA.cpu_node == nullptr)
+        fprintf(stderr, "allocation error\n");
+      else
+        numa_cpu_nodes(IA.cpu_node, IA.n_cpus);
+    }
+  }
+
+  // Partition the calling thread takes its next block from.
+  // The node is asked once per block, as the kernel may move the thread.
+  // sched_getcpu() reads it without a system call (vDSO or rseq), and
+  // the CPU's node comes from the table of initParts().
+  int thread_part(alloc_cache_t* cache) {
+    if(IA.n_parts == 1)
+      return 0;
+
+    if(cache->node >= 0)
+      return cache->node % IA.n_parts;
+
+    int cpu = sched_getcpu();
+    if(cpu < 0 || cpu >= IA.n_cpus || IA.cpu_node == nullptr)
+      return 0;
+    return IA.cpu_node[cpu] % IA.n_parts;
+  }
+
+  // Zeroed nodes on the memory of NUMA node, in whole pages of their own.
+  // The policy is set before the pages are first touched. It is only a
+  // preference, and a machine without the node ignores it.
+  node_t* alloc_on_node(size_t n, int node) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t len = (n * sizeof(node_t) + page - 1) / page * page;
+    void* ptr = nullptr;
+    if(posix_memalign(&ptr, MAX_ALIGN(page, alignof(node_t)), len))
+      return nullptr;
+
+    unsigned long mask[MAX_NUMA_NODES / 64 + 1] = {0};
+    mask[node / 64] = 1UL << (node % 64);
+    syscall(SYS_mbind, ptr, len, MPOL_PREFERRED, mask,
+        MAX_NUMA_NODES + 1, MPOL_MF_MOVE);
+
+    memset(ptr, 0, len);
+    return (node_t*)ptr;
+  }
+
+  // ith segment array must be deallocated.
+  // A node of -1 leaves the placement to the kernel.
+  node_t* allocate_new_array(int i, int node) {
+    node_t* ptr = node < 0 ? alloc_cache_aligned(IA.s_size)
+      : alloc_on_node(IA.s_size, node);
+    if(!ptr) {
+      fprintf(stderr, "allocation error\n");
+    }
+
+    for(size_t s = 0; s < IA.s_size; s++) {
+      ptr[s].metaData.i_idx = i;
+      ptr[s].metaData.s_idx = s;
+    }
+    return ptr;
+  }
+
+  alloc_cache_t* get_thread_cache() {
+    alloc_cache_t* cache = (alloc_cache_t*)pthread_getspecific(cache_key);
+    if(cache)
+      return cache;
+
+    // Reuse the cache of a thread that exited.
+    for(cache = caches; cache; cache = cache->next_cache)
+      if(!cache->in_use && __sync_bool_compare_and_swap(&cache->in_use, 0, 1))
+        break;
+
+    if(!cache) {
+      // A line of its own, so that threads don't share their caches' line.
+      void* ptr = nullptr;
+      if(posix_memalign(&ptr, CACHE_LINE_SIZE, sizeof(alloc_cache_t))) {
+        fprintf(stderr, "allocation error\n");
+        abort();
+      }
+      cache = (alloc_cache_t*)ptr;
+      cache->pool = this;
+      cache->part = 0;
+      cache->walk_epoch = 0;
+      cache->walk_depth = 0;
+      cache->in_use = 1;
+      memset(&cache->stats, 0, sizeof(cache->stats));
+      do {
+        cache->next_cache = caches;
+      } while(!__sync_bool_compare_and_swap(&caches,
+            cache->next_cache, cache));
+    }
+
+    cache->next = cache->end = 0;
+    cache->node = -1;
+    pthread_setspecific(cache_key, cache);
+
+    return cache;
+  }
+
+  // Called at the exit of a thread which has a cache.
+  static void release_cache_at_exit(void* arg) {
+    NodePool* pool = ((alloc_cache_t*)arg)->pool;
+
+    // release_thread_cache() takes the cache from the key again.
+    pthread_setspecific(pool->cache_key, arg);
+    pool->release_thread_cache();
+  }
+
+  static void* wrap_deallocate(void* arg) {
+    NodePool *pool = (NodePool*)arg;
+    pool->lazy_deAllocate(arg);
+
+    return nullptr;
+  }
+
+  // next_s_idx only grows, so a slot is identified by
+  // (round, segment array, offset) without any modulo on the counter.
+  //
+  // Before slots of a segment array are handed out in a new round, one
+  // thread decides whether the array is recycled (USE) or SKIPped for that
+  // round. The array is recycled only when every node of its previous USE
+  // round is unlinked. Otherwise every slot of the round is skipped, so a
+  // node that stays linked, e.g. the OBSOLETE tail of a list which is never
+  // appended again, does not stall the allocation of other lists.
+  //
+  // Each partition has a counter of its own, over its own arrays.
+  //
+  // Return the node of slot total_s_idx, or nullptr if its round is skipped.
+  node_t* claim_slot(int part, size_t total_s_idx) {
+    const numa_part_t* p = &IA.parts[part];
+    size_t i_idx, s_idx, round;
+
+    i_idx = p->first + (total_s_idx / IA.s_size) % p->n; // circular moving
+    s_idx = total_s_idx % IA.s_size;
+    round = total_s_idx / (IA.s_size * p->n);
+
+    while(true) {
+      size_t state = IA.seg_state[i_idx];
+
+      if(SEG_ROUND(state) < round && SEG_STATUS(state) != SEG_DECIDING) {
+        // Nobody has decided this round yet.
+        if(__sync_bool_compare_and_swap(&IA.seg_state[i_idx], state,
+              SEG_STATE(round, SEG_DECIDING)))
+          decide_seg_array(i_idx, round);
+        else
+          LIST_STAT(thread_stats(), alloc_cas_failures, 1);
+        continue;
+      }
+
+      if(IA.seg_used_round[i_idx] == round) {
+        // Check if the segment array is valid, and the lock is initialized.
+        // If both are true, return the lock
+        if(HAS_INVALID_BIT(IA.indexArray[i_idx]) == false
+            && IA.indexArray[i_idx][s_idx].status == INVALID)
+          break;
+      } else if(SEG_ROUND(state) > round
+          || (SEG_ROUND(state) == round && SEG_STATUS(state) == SEG_SKIP)) {
+        skip_seg_array(part, total_s_idx);
+        return nullptr;
+      }
+
+      // Another thread is deciding or reinitializing the array.
+      LIST_STAT(thread_stats(), alloc_waits, 1);
+      sched_yield();
+    }
+
+    return &IA.indexArray[i_idx][s_idx];
+  }
+
+  // The caller owns the decision of round for the ith segment array.
+  void decide_seg_array(size_t i, size_t round) {
+    if(!BVector_is_clear(i))
+      help_unlink();
+
+    if(BVector_is_clear(i) && !is_walked(i)) {
+      IA.seg_used_round[i] = round;
+      reinit_seg_array(i);
+      __sync_synchronize();
+      IA.seg_state[i] = SEG_STATE(round, SEG_USE);
+      LIST_STAT(thread_stats(), seg_reinits, 1);
+    } else {
+      __sync_synchronize();
+      IA.seg_state[i] = SEG_STATE(round, SEG_SKIP);
+      LIST_STAT(thread_stats(), seg_skips, 1);
+    }
+  }
+
+  // Move next_s_idx to the next segment array that can be recycled,
+  // so that other threads neither walk through the skipped one slot by
+  // slot nor decide on arrays which are still in use. If there is none,
+  // move to the next one, whose decision unlinks what it can.
+  // Within the partition.
+  void skip_seg_array(int part, size_t total_s_idx) {
+    numa_part_t* p = &IA.parts[part];
+    size_t g = total_s_idx / IA.s_size; // segment arrays so far
+    size_t i = g % p->n;
+    size_t j = BVector_find_clear(p->first + (i + 1) % p->n, p->first, p->n)
+      - p->first;
+    size_t distance = j == p->n || j == i ? 1 : (j + p->n - i) % p->n;
+
+    size_t target = (g + distance) * IA.s_size;
+    size_t next = p->next_s_idx;
+
+    while(next < target
+        && !__sync_bool_compare_and_swap(&p->next_s_idx, next, target)) {
+      LIST_STAT(thread_stats(), alloc_cas_failures, 1);
+      next = p->next_s_idx;
+    }
+  }
+
+  // True if a walk that may hold a node of the ith segment array,
+  // which is clear, is running.
+  bool is_walked(size_t i) {
+    size_t clear_epoch = IA.seg_clear_epoch[i];
+    for(alloc_cache_t* cache = caches; cache; cache = cache->next_cache) {
+      size_t walk_epoch = cache->walk_epoch;
+      if(walk_epoch != 0 && walk_epoch <= clear_epoch)
+        return true;
+    }
+    return false;
+  }
+
+  // Unlink OBSOLETE nodes of every attached list.
+  void help_unlink() {
+    for(size_t i = 0; i < lists.size(); i++)
+      lists[i]->next_pointer_update();
+  }
+
+  // Levels of the words of a segment array, from the leaves up.
+  void initBVector() {
+    size_t words = (IA.s_size + BVECTOR_BITS - 1) / BVECTOR_BITS;
+    size_t offset = 0;
+
+    IA.BVector_levels = 0;
+    while(true) {
+      IA.BVector_level_offset[IA.BVector_levels++] = offset;
+      offset += words;
+      if(words == 1)
+        break;
+      words = (words + BVECTOR_BITS - 1) / BVECTOR_BITS;
+    }
+
+    // Arrays don't share lines, so unlinks in different ones don't collide.
+    size_t line_words = CACHE_LINE_SIZE / sizeof(uint64_t);
+    IA.BVector_seg_words = (offset + line_words - 1) / line_words * line_words;
+
+    void* ptr = nullptr;
+    if(posix_memalign(&ptr, CACHE_LINE_SIZE,
+          IA.i_size * IA.BVector_seg_words * sizeof(uint64_t)))
+      fprintf(stderr, "allocation error\n");
+    IA.BVector = (uint64_t*)ptr;
+    memset(IA.BVector, 0, IA.i_size * IA.BVector_seg_words * sizeof(uint64_t));
+
+    // Bits past the last segment array stay on, so they never look clear.
+    size_t summary_words = (IA.i_size + BVECTOR_BITS - 1) / BVECTOR_BITS;
+    IA.BVector_summary = (uint64_t*)calloc(summary_words, sizeof(uint64_t));
+    if(IA.i_size % BVECTOR_BITS)
+      IA.BVector_summary[summary_words - 1] =
+        ~0ULL << (IA.i_size % BVECTOR_BITS);
+  }
+
+  // Set the bits of every node of the idx th segment array.
+  // Nobody else touches them: all the nodes are unlinked.
+  void BVector_turn_on_bits(int idx) {
+    uint64_t* bits = IA.BVector + idx * IA.BVector_seg_words;
+    size_t n_bits = IA.s_size;
+
+    for(int k = 0; k < IA.BVector_levels; k++) {
+      uint64_t* level = bits + IA.BVector_level_offset[k];
+      size_t n_words = (n_bits + BVECTOR_BITS - 1) / BVECTOR_BITS;
+
+      for(size_t w = 0; w < n_words; w++) {
+        size_t left = n_bits - w * BVECTOR_BITS;
+        level[w] = left >= BVECTOR_BITS ? ~0ULL : (1ULL << left) - 1;
+      }
+      n_bits = n_words;
+    }
+
+    __sync_fetch_and_or(&IA.BVector_summary[idx / BVECTOR_BITS],
+        1ULL << (idx % BVECTOR_BITS));
+  }
+};
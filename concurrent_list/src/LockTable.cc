@@ -0,0 +1,111 @@
+#include "LockTable.h"
+
+#include <sched.h>
+
+// Round up to a multiple of 8 as NodePool requires.
+static size_t pool_size(size_t n_buckets) {
+  return (n_buckets + LOCK_TABLE_SPARE_SEG_ARRAYS + 7) & ~(size_t)0x7;
+}
+
+LockTable::LockTable(size_t n_buckets, bool park)
+  : pool(pool_size(n_buckets)) {
+  this->n_buckets = n_buckets;
+  this->park = park;
+  buckets = new bucket_t*[n_buckets];
+
+  // Every bucket registers itself to the shared pool.
+  for(size_t i = 0; i < n_buckets; i++)
+    buckets[i] = new bucket_t(&pool);
+}
+
+LockTable::~LockTable() {
+  for(size_t i = 0; i < n_buckets; i++)
+    delete buckets[i];
+  delete[] buckets;
+}
+
+LockTable::lock_t* LockTable::acquire(uint64_t txn_id, uint32_t rid,
+                                      enum lock_mode mode) {
+  bucket_t* bucket = get_bucket(rid);
+  lock_request_t request = {txn_id, rid, mode};
+  lock_t* lock = bucket->push_back(request);
+
+  // Conflicting locks before ours are released eventually,
+  // and locks after ours never block us.
+  // A release wakes the threads parked on the lock. A lock released
+  // while we spun is checked again at once.
+  bucket_t::wait_ticket_t ticket;
+  enum check_result result = check_conflict(bucket, lock,
+                                            park ? &ticket : nullptr);
+  if(result == GRANTED)
+    return lock;
+
+  lock->status = bucket_t::WAIT;
+  do {
+    if(result == WAITING)
+      bucket->wait(&ticket);
+    else if(result == UNDECIDED || !park)
+      sched_yield();
+  } while((result = check_conflict(bucket, lock, park ? &ticket : nullptr))
+      != GRANTED);
+  lock->status = bucket_t::ACTIVE;
+
+  return lock;
+}
+
+LockTable::lock_t* LockTable::try_acquire(uint64_t txn_id, uint32_t rid,
+                                          enum lock_mode mode) {
+  bucket_t* bucket = get_bucket(rid);
+  lock_request_t request = {txn_id, rid, mode};
+  lock_t* lock = bucket->push_back(request);
+
+  enum check_result result;
+  while((result = check_conflict(bucket, lock, nullptr)) == UNDECIDED)
+    sched_yield();
+
+  if(result == CONFLICT) {
+    bucket->erase(lock);
+    return nullptr;
+  }
+
+  return lock;
+}
+
+void LockTable::release(lock_t* lock) {
+  get_bucket(lock->elem.rid)->erase(lock);
+}
+
+size_t LockTable::get_num_buckets() {
+  return n_buckets;
+}
+
+LockTable::bucket_t* LockTable::get_bucket(uint32_t rid) {
+  // Multiplicative hashing, so that neighbouring rids spread over buckets.
+  return buckets[(rid * 2654435761U) % n_buckets];
+}
+
+enum LockTable::check_result
+LockTable::check_conflict(bucket_t* bucket, lock_t* lock,
+                          bucket_t::wait_ticket_t* ticket) {
+  const lock_request_t& request = lock->elem;
+
+  // Our lock is not OBSOLETE, so it is never unlinked and the walk reaches
+  // it unless an insert before it is still in progress.
+  for(bucket_t::iterator it = bucket->begin(); it != bucket->end(); ++it) {
+    if(it.get_node() == lock)
+      return GRANTED;
+
+    if(it->rid != request.rid)
+      continue;
+
+    if(request.mode == EXCLUSIVE || it->mode == EXCLUSIVE) {
+      // The iterator keeps the conflicting lock from being recycled
+      // until the thread is registered.
+      if(ticket && bucket->prepare_wait(it.get_node(), ticket))
+        return WAITING;
+      return CONFLICT;
+    }
+  }
+
+  return UNDECIDED;
+}
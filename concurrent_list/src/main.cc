@@ -3,26 +3,28 @@
 #include <cstdlib>
 #include <vector>
 #include "ConcurrentList.h"
+#include "task_pool.h"
 
-#define N_THREAD 64
+// Tasks, each on a thread of a pool of their own.
+#define N_TASK 64
 
 using namespace std;
 
-bool is_correct(ConcurrentList & list, size_t s) {
+bool is_correct(ConcurrentList<int> & list, size_t s) {
   if(list.size() != s)
     return false;
 
   size_t count = 0;
   size_t actual_size = 0;
 
-  ConcurrentList::node_t* head = list.getHead();
+  ConcurrentList<int>::node_t* head = list.getHead();
 
   while(1) {
     head = list.getNext(head);
     if(!head) break;
 
     actual_size++;
-    if(head->status == ConcurrentList::OBSOLETE)
+    if(head->status == ConcurrentList<int>::OBSOLETE)
       continue;
 
     count++;
@@ -33,22 +35,17 @@ bool is_correct(ConcurrentList & list, size_t s) {
   return count == s;
 }
 
-void* thread_main(void* args) {
-  long* args_ary = (long*) args;
+void task_main(long tid, ConcurrentList<int>* list) {
+  std::vector<ConcurrentList<int>::node_t*> nodes;
 
-  long tid = (long)args_ary[0];
-  ConcurrentList* list = (ConcurrentList*) args_ary[1];
-
-  std::vector<ConcurrentList::node_t*> nodes;
-
-  //printf("Thread %ld start.\n", tid);
+  //printf("Task %ld start.\n", tid);
 
   for(int k = 0; k < 32;k++) {
     for(int i = 0; i < 4; i++) {
       nodes.push_back(list->push_back(tid * 1000000 + i));
     }
     
-    //printf("Thread %ld end.\n", tid);
+    //printf("Task %ld end.\n", tid);
     
     int cnt = 0;
     for(auto it = nodes.rbegin();
@@ -60,29 +57,25 @@ void* thread_main(void* args) {
     nodes.clear();
     pthread_yield();
   }
- 
-  delete[] args_ary;
-  pthread_exit((void *) 0);
 }
 
-pthread_t threads[N_THREAD];
-
 int main(void)
 {
-  ConcurrentList list;
-
-  int tid = 1;
-
-  for(int i = 0; i < N_THREAD; i++) {
-    long* args = new long[2];
-    args[0] = tid++;
-    args[1] = (long)&list;
-
-    pthread_create(&threads[i], NULL, thread_main, (void *)args);
-  }
-
-  for(int i = 0; i < N_THREAD; i++) {
-    pthread_join(threads[i], NULL);
+  ConcurrentList<int> list;
+
+  // A worker per task but the caller's, so that the tasks contend however
+  // many cores there are, unlike on task_pool_t::instance(). The workers
+  // are joined before the list is checked and destroyed, so they release
+  // their node caches first (see NodePool).
+  {
+    task_pool_t pool(N_TASK - 1);
+
+    // A task per chunk of one, so every task may run on another thread.
+    pool.parallel_for(N_TASK, N_TASK, [&](int, int64_t begin, int64_t end) {
+      for(int64_t i = begin; i < end; i++) {
+        task_main(i + 1, &list);
+      }
+    }, 1);
   }
 
   list.next_pointer_update();
@@ -91,7 +84,7 @@ int main(void)
   printf("Active nodes: %ld\n", list.size());
   printf("%s\n", is_correct(list, list.size()) ? "Correct\n" : "Incorrect\n");
 
-  /* for(int i = 0; i < N_THREAD; i++) {
+  /* for(int i = 0; i < N_TASK; i++) {
    *   list.BVector_turn_off_bits_check_by_array(i);
    * } */
 
@@ -0,0 +1,109 @@
+// Edge updates per second of apply_batch() against add_edge() and
+// del_edge() one edge at a time, on a random graph with and without
+// sorted adjacent nodes. Half of the updates of a batch delete edges of
+// the graph, the other half insert random edges.
+//
+// Usage: batch_bench [nodes] [degree] [max threads]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include "graph.h"
+#include "bench.h"
+
+#define N_UPDATES (1 << 20) // per batch size
+
+// A batch of n updates, which keeps edges those of the graph.
+static void make_batch(std::vector<edge_t> &edges, int64_t n,
+                       int32_t num_nodes, std::mt19937 &rng,
+                       std::vector<edge_t> &inserts,
+                       std::vector<edge_t> &deletes) {
+  inserts.clear();
+  deletes.clear();
+  for (int64_t i = 0; i < n / 2 && !edges.empty(); ++i) {
+    size_t j = rng() % edges.size();
+    deletes.push_back(edges[j]);
+    edges[j] = edges.back();
+    edges.pop_back();
+  }
+  for (int64_t i = 0; i < n - n / 2; ++i) {
+    inserts.push_back(edge_t(rng() % num_nodes, rng() % num_nodes));
+  }
+  edges.insert(edges.end(), inserts.begin(), inserts.end());
+}
+
+static void bench_graph(int32_t num_nodes, int32_t degree, bool sorted,
+                        int max_threads) {
+  std::mt19937 rng(1);
+  std::vector<edge_t> edges, inserts, deletes;
+  char extra[64];
+  snprintf(extra, sizeof(extra), ", \"sorted\": %s",
+      sorted ? "true" : "false");
+
+  graph g(num_nodes, sorted);
+  make_batch(edges, (int64_t)num_nodes * degree, num_nodes, rng, inserts,
+      deletes);
+
+  latency_t load_latency;
+  uint64_t start = bench_now_ns();
+  g.apply_batch(inserts, deletes, max_threads);
+  double seconds = (bench_now_ns() - start) * 1e-9;
+  load_latency.add(bench_now_ns() - start);
+  bench_report("graph", "apply_batch_load", inserts.size(), max_threads,
+      inserts.size(), seconds, load_latency, extra);
+
+  for (int64_t batch = 1000; batch <= N_UPDATES; batch *= 16) {
+    for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+      latency_t latency;
+      int64_t n_applied = 0, n_updates = 0;
+      int64_t n_batches = N_UPDATES / batch;
+      seconds = 0;
+      for (int64_t i = 0; i < n_batches; ++i) {
+        make_batch(edges, batch, num_nodes, rng, inserts, deletes);
+        n_updates += inserts.size() + deletes.size();
+        uint64_t t = bench_now_ns();
+        n_applied += g.apply_batch(inserts, deletes, n_threads);
+        uint64_t elapsed = bench_now_ns() - t;
+        latency.add(elapsed);
+        seconds += elapsed * 1e-9;
+      }
+      if (n_applied != n_updates) {
+        fprintf(stderr, "batch_bench: %ld of %ld updates applied\n",
+            (long)n_applied, (long)n_updates);
+      }
+      bench_report("graph", "apply_batch", batch, n_threads, n_applied,
+          seconds, latency, extra);
+    }
+  }
+
+  // The same kind of updates, one edge at a time.
+  latency_t latency;
+  latency.reserve(N_UPDATES);
+  make_batch(edges, N_UPDATES, num_nodes, rng, inserts, deletes);
+  start = bench_now_ns();
+  for (auto &e : deletes) {
+    uint64_t t = bench_now_ns();
+    g.del_edge(e.first, e.second);
+    latency.add(bench_now_ns() - t);
+  }
+  for (auto &e : inserts) {
+    uint64_t t = bench_now_ns();
+    g.add_edge(e.first, e.second);
+    latency.add(bench_now_ns() - t);
+  }
+  seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("graph", "add_del_edge", 1, 1, N_UPDATES, seconds, latency,
+      extra);
+}
+
+int main(int argc, char *argv[])
+{
+  int32_t num_nodes = argc > 1 ? atoi(argv[1]) : 1 << 20;
+  int32_t degree = argc > 2 ? atoi(argv[2]) : 16;
+  int max_threads = argc > 3 ? atoi(argv[3]) : 4;
+
+  bench_graph(num_nodes, degree, false, max_threads);
+  bench_graph(num_nodes, degree, true, max_threads);
+
+  return 0;
+}
@@ -0,0 +1,116 @@
+// Size of a compressed_graph_t against a CSR of int32_t adjacent nodes,
+// and its BFS and shortest path speed against graph and csr_t, on an
+// R-MAT graph.
+//
+// Usage: compressed_bench [scale] [edge factor] [threads]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include "graph.h"
+#include "csr.h"
+#include "compressed.h"
+#include "path.h"
+#include "bench.h"
+#include "rmat.h"
+#include "full_bfs.h"
+
+#define N_BFS 8
+#define N_QUERIES 10000
+
+template <typename G>
+static void bench_traversal(const G &g, const char *on,
+                            const std::vector<int32_t> &sources,
+                            const std::vector<edge_t> &queries) {
+  char extra[64];
+  snprintf(extra, sizeof(extra), ", \"on\": \"%s\"", on);
+
+  latency_t latency;
+  int64_t reached = 0;
+  uint64_t start = bench_now_ns();
+  for (auto s : sources) {
+    uint64_t t = bench_now_ns();
+    reached += BFS(g, s);
+    latency.add(bench_now_ns() - t);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+  if (reached == 0) {
+    fprintf(stderr, "compressed_bench: BFS on %s reached nothing\n", on);
+  }
+  bench_report("graph", "bfs", g.get_num_nodes(), 1, sources.size(),
+      seconds, latency, extra);
+
+  path_finder_t<G> finder(g);
+  latency_t path_latency;
+  path_latency.reserve(queries.size());
+  start = bench_now_ns();
+  for (auto &q : queries) {
+    uint64_t t = bench_now_ns();
+    finder.shortest_path(q.first, q.second);
+    path_latency.add(bench_now_ns() - t);
+  }
+  seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("graph", "shortest_path", g.get_num_nodes(), 1,
+      queries.size(), seconds, path_latency, extra);
+}
+
+int main(int argc, char *argv[])
+{
+  int scale = argc > 1 ? atoi(argv[1]) : 18;
+  int edge_factor = argc > 2 ? atoi(argv[2]) : 16;
+  int n_threads = argc > 3 ? atoi(argv[3]) : 1;
+
+  int32_t num_nodes = 1 << scale;
+  std::mt19937 rng(1);
+  std::vector<edge_t> edges((int64_t)num_nodes * edge_factor);
+  for (auto &e : edges) {
+    rmat_edge(scale, rng, e.first, e.second);
+  }
+
+  graph g(num_nodes);
+  for (auto &e : edges) {
+    g.add_edge(e.first, e.second);
+  }
+  csr_t adj(g);
+
+  latency_t build_latency;
+  uint64_t start = bench_now_ns();
+  compressed_graph_t compressed(num_nodes, edges, n_threads);
+  double seconds = (bench_now_ns() - start) * 1e-9;
+  build_latency.add(bench_now_ns() - start);
+
+  // A CSR of int32_t adjacent nodes and int64_t offsets.
+  int64_t csr_bytes = compressed.get_num_edges() * sizeof(int32_t)
+    + ((int64_t)num_nodes + 1) * sizeof(int64_t);
+  char extra[160];
+  snprintf(extra, sizeof(extra),
+      ", \"bytes\": %ld, \"csr_bytes\": %ld, \"ratio\": %.2f, "
+      "\"bits_per_edge\": %.2f", (long)compressed.get_num_bytes(),
+      (long)csr_bytes, (double)csr_bytes / compressed.get_num_bytes(),
+      8.0 * compressed.get_num_bytes() / compressed.get_num_edges());
+  bench_report("graph", "compress", num_nodes, n_threads, edges.size(),
+      seconds, build_latency, extra);
+
+  std::vector<int32_t> sources;
+  while (sources.size() < N_BFS) {
+    int32_t s = rng() % num_nodes;
+    if (adj.get_degree(s)) {
+      sources.push_back(s);
+    }
+  }
+  std::vector<edge_t> queries(N_QUERIES);
+  for (auto &q : queries) {
+    do {
+      q.first = rng() % num_nodes;
+    } while (adj.get_degree(q.first) == 0);
+    do {
+      q.second = rng() % num_nodes;
+    } while (adj.get_degree(q.second) == 0);
+  }
+
+  bench_traversal(g, "graph", sources, queries);
+  bench_traversal(adj, "csr", sources, queries);
+  bench_traversal(compressed, "compressed", sources, queries);
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+// DFS and biconnected components on an R-MAT graph, as graph and as
+// csr_t, and on a path of many nodes with a chord over every other pair,
+// as deep a DFS as there is.
+//
+// Usage: dfs_bench [scale] [edge factor] [path nodes]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include "graph.h"
+#include "csr.h"
+#include "dfs.h"
+#include "biconnected.h"
+#include "bench.h"
+#include "rmat.h"
+
+#define N_RUNS 3
+
+// A CSR built in place, as a graph of this size doesn't fit as deques.
+// Node v is adjacent to v - 1 and v + 1, and if v % 4 is 0 to v + 2,
+// so it is a chain of triangles joined by bridges.
+class path_graph_t
+{
+public:
+  path_graph_t (const int32_t num_nodes) : num_nodes(num_nodes) {
+    offsets.reserve(num_nodes + 1);
+    offsets.push_back(0);
+    for (int32_t v = 0; v < num_nodes; ++v) {
+      add_adj(v - 1);
+      add_adj(v + 1);
+      if (v % 4 == 0) {
+        add_adj(v + 2);
+      } else if (v % 4 == 2) {
+        add_adj(v - 2);
+      }
+      offsets.push_back(adj.size());
+    }
+  }
+
+  int32_t get_num_nodes() const { return num_nodes; }
+  int64_t get_num_edges() const { return adj.size(); }
+  const int32_t* adj_begin(const int32_t node) const {
+    return adj.data() + offsets[node];
+  }
+  const int32_t* adj_end(const int32_t node) const {
+    return adj.data() + offsets[node + 1];
+  }
+
+private:
+  int32_t num_nodes;
+  std::vector<int64_t> offsets;
+  std::vector<int32_t> adj;
+
+  void add_adj(const int32_t u) {
+    if (u >= 0 && u < num_nodes) {
+      adj.push_back(u);
+    }
+  }
+};
+
+template <typename G>
+static void bench_dfs(const G &g, const char *on, const int64_t num_edges) {
+  int32_t num_nodes = g.get_num_nodes();
+  char extra[192];
+  latency_t dfs_latency;
+
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < N_RUNS; ++i) {
+    uint64_t t = bench_now_ns();
+    dfs_t<G> dfs(g);
+    dfs_visitor_t visitor;
+    dfs.run_all(visitor);
+    dfs_latency.add(bench_now_ns() - t);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+  snprintf(extra, sizeof(extra), ", \"on\": \"%s\", \"edges\": %ld",
+      on, (long)num_edges / 2);
+  bench_report("graph", "dfs", num_nodes, 1, N_RUNS, seconds, dfs_latency,
+      extra);
+
+  latency_t latency;
+  biconnected_t result;
+  start = bench_now_ns();
+  for (int i = 0; i < N_RUNS; ++i) {
+    uint64_t t = bench_now_ns();
+    result = find_biconnected(g);
+    latency.add(bench_now_ns() - t);
+  }
+  seconds = (bench_now_ns() - start) * 1e-9;
+  snprintf(extra, sizeof(extra), ", \"on\": \"%s\", \"edges\": %ld"
+      ", \"bridges\": %ld, \"articulation_points\": %ld"
+      ", \"components\": %ld", on, (long)num_edges / 2,
+      (long)result.bridges.size(), (long)result.articulation_points.size(),
+      (long)result.offsets.size() - 1);
+  bench_report("graph", "biconnected", num_nodes, 1, N_RUNS, seconds,
+      latency, extra);
+}
+
+int main(int argc, char *argv[])
+{
+  int scale = argc > 1 ? atoi(argv[1]) : 18;
+  int edge_factor = argc > 2 ? atoi(argv[2]) : 16;
+  int32_t path_nodes = argc > 3 ? atoi(argv[3]) : 10000000;
+
+  {
+    int32_t num_nodes = 1 << scale;
+    std::mt19937 rng(1);
+    graph g(num_nodes);
+    for (int64_t i = 0; i < (int64_t)num_nodes * edge_factor; ++i) {
+      int32_t from, to;
+      rmat_edge(scale, rng, from, to);
+      g.add_edge(from, to);
+    }
+    csr_t adj(g);
+
+    bench_dfs(g, "graph", adj.get_num_edges());
+    bench_dfs(adj, "csr", adj.get_num_edges());
+  }
+
+  path_graph_t path(path_nodes);
+  bench_dfs(path, "path", path.get_num_edges());
+
+  return 0;
+}
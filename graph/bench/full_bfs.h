@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Full BFS from start_node on any graph with for_each_adj(), e.g. graph,
+// csr_t, compressed_graph_t or graph_snapshot_t. Returns the number of
+// nodes reached.
+template <typename G>
+static int64_t BFS(const G &g, const int32_t start_node) {
+  std::vector<bool> visited(g.get_num_nodes());
+  std::vector<int32_t> queue;
+
+  visited[start_node] = true;
+  queue.push_back(start_node);
+  for (size_t i = 0; i < queue.size(); ++i) {
+    g.for_each_adj(queue[i], [&](int32_t u) {
+      if (!visited[u]) {
+        visited[u] = true;
+        queue.push_back(u);
+      }
+    });
+  }
+  return queue.size();
+}
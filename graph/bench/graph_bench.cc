@@ -0,0 +1,130 @@
+// Latency and throughput of graph construction, BFS and has_edge.
+// Graphs are random with an average degree of DEGREE.
+//
+// Usage: graph_bench [max nodes]
+#include <cstdlib>
+#include <vector>
+#include <deque>
+#include <random>
+#include "graph.h"
+#include "bench.h"
+
+#define DEGREE 8
+#define N_BFS 16
+
+// BFS of src/main.cc, without printing. Returns the number of nodes reached.
+static size_t BFS(graph &g, const int32_t start_node) {
+  std::vector<bool> visited(g.get_num_nodes());
+  std::deque<int32_t> queue;
+  size_t n_visited = 1;
+
+  visited[start_node] = true;
+  queue.push_back(start_node);
+
+  while (!queue.empty()) {
+    int32_t current_node = queue.front();
+    queue.pop_front();
+
+    for (auto i : g.get_adj_nodes(current_node)) {
+      if (!visited[i]) {
+        visited[i] = true;
+        queue.push_back(i);
+        n_visited++;
+      }
+    }
+  }
+
+  return n_visited;
+}
+
+static void bench_size(int32_t num_nodes, std::mt19937& rng) {
+  size_t num_edges = (size_t)num_nodes * DEGREE / 2;
+  std::vector<std::pair<int32_t, int32_t>> edges(num_edges);
+  for (auto &e : edges) {
+    e.first = rng() % num_nodes;
+    e.second = rng() % num_nodes;
+  }
+
+  graph g(num_nodes);
+  latency_t latency;
+  latency.reserve(num_edges);
+
+  uint64_t start = bench_now_ns();
+  for (auto &e : edges) {
+    uint64_t t = bench_now_ns();
+    g.add_edge(e.first, e.second);
+    latency.add(bench_now_ns() - t);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("graph", "add_edge", num_nodes, 1, num_edges, seconds, latency);
+
+  latency_t bfs_latency;
+  size_t reached = 0;
+
+  start = bench_now_ns();
+  for (int i = 0; i < N_BFS; ++i) {
+    uint64_t t = bench_now_ns();
+    reached += BFS(g, rng() % num_nodes);
+    bfs_latency.add(bench_now_ns() - t);
+  }
+  seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("graph", "bfs", num_nodes, 1, N_BFS, seconds, bfs_latency);
+
+  // Half of the queries are edges of the graph.
+  latency_t has_latency;
+  has_latency.reserve(num_edges);
+  size_t found = 0;
+
+  start = bench_now_ns();
+  for (size_t i = 0; i < num_edges; ++i) {
+    int32_t from, to;
+    if (i % 2) {
+      from = edges[i].first;
+      to = edges[i].second;
+    } else {
+      from = rng() % num_nodes;
+      to = rng() % num_nodes;
+    }
+    uint64_t t = bench_now_ns();
+    found += g.has_edge(from, to);
+    has_latency.add(bench_now_ns() - t);
+  }
+  seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("graph", "has_edge", num_nodes, 1, num_edges, seconds,
+      has_latency);
+
+  // The same queries once adjacent nodes are sorted.
+  g.sort_adj();
+
+  latency_t sorted_latency;
+  sorted_latency.reserve(num_edges);
+  size_t sorted_found = 0;
+
+  start = bench_now_ns();
+  for (size_t i = 0; i < num_edges; ++i) {
+    int32_t from = i % 2 ? edges[i].first : rng() % num_nodes;
+    int32_t to = i % 2 ? edges[i].second : rng() % num_nodes;
+    uint64_t t = bench_now_ns();
+    sorted_found += g.has_edge(from, to);
+    sorted_latency.add(bench_now_ns() - t);
+  }
+  seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("graph", "has_edge_sorted", num_nodes, 1, num_edges, seconds,
+      sorted_latency);
+
+  if (found < num_edges / 2 || sorted_found < num_edges / 2 || reached == 0) {
+    std::cerr << "graph: unexpected result" << std::endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int32_t max_nodes = argc > 1 ? atoi(argv[1]) : 100000;
+  std::mt19937 rng(1);
+
+  for (int32_t num_nodes = 1000; num_nodes <= max_nodes; num_nodes *= 10) {
+    bench_size(num_nodes, rng);
+  }
+
+  return 0;
+}
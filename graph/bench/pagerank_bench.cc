@@ -0,0 +1,92 @@
+// Iterations per second of PageRank and SpMV on a random graph,
+// with and without CSR segmenting.
+//
+// Usage: pagerank_bench [nodes] [degree] [max threads] [segment size]
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <random>
+#include "graph.h"
+#include "csr.h"
+#include "pagerank.h"
+#include "bench.h"
+
+#define MAX_ITERATIONS 100
+#define TOLERANCE 1e-6f
+#define N_SPMV 20
+
+static void bench_csr(const csr_t &csr, int n_threads) {
+  int32_t num_nodes = csr.get_num_nodes();
+  char extra[128];
+  snprintf(extra, sizeof(extra),
+      ", \"edges\": %ld, \"segments\": %d",
+      (long)csr.get_num_edges(), csr.get_num_segments());
+
+  std::vector<float> x(num_nodes, 1.0f), y(num_nodes);
+  latency_t spmv_latency;
+
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < N_SPMV; ++i) {
+    uint64_t t = bench_now_ns();
+    csr.spmv(x.data(), y.data(), n_threads);
+    spmv_latency.add(bench_now_ns() - t);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("graph", "spmv", num_nodes, n_threads, N_SPMV, seconds,
+      spmv_latency, extra);
+
+  // One iteration per run() to time each of them.
+  pagerank_t pr(csr);
+  latency_t latency;
+  int iterations = 0;
+
+  start = bench_now_ns();
+  while (iterations < MAX_ITERATIONS) {
+    uint64_t t = bench_now_ns();
+    iterations += pr.run(1, TOLERANCE, n_threads);
+    latency.add(bench_now_ns() - t);
+    if (pr.get_delta() < TOLERANCE) {
+      break;
+    }
+  }
+  seconds = (bench_now_ns() - start) * 1e-9;
+
+  double rank_sum = 0;
+  for (auto r : pr.get_ranks()) {
+    rank_sum += r;
+  }
+  if (std::fabs(rank_sum - 1.0) > 1e-2) {
+    fprintf(stderr, "pagerank: ranks sum to %f\n", rank_sum);
+  }
+
+  snprintf(extra, sizeof(extra),
+      ", \"edges\": %ld, \"segments\": %d, \"delta\": %g",
+      (long)csr.get_num_edges(), csr.get_num_segments(), pr.get_delta());
+  bench_report("graph", "pagerank_iteration", num_nodes, n_threads,
+      iterations, seconds, latency, extra);
+}
+
+int main(int argc, char *argv[])
+{
+  int32_t num_nodes = argc > 1 ? atoi(argv[1]) : 250000;
+  int32_t degree = argc > 2 ? atoi(argv[2]) : 16;
+  int max_threads = argc > 3 ? atoi(argv[3]) : 4;
+  int32_t segment_size = argc > 4 ? atoi(argv[4]) : 1 << 16;
+
+  std::mt19937 rng(1);
+  graph g(num_nodes);
+  for (int64_t i = 0; i < (int64_t)num_nodes * degree / 2; ++i) {
+    g.add_edge(rng() % num_nodes, rng() % num_nodes);
+  }
+
+  csr_t csr(g);
+  csr_t segmented(g, segment_size);
+
+  for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+    bench_csr(csr, n_threads);
+    bench_csr(segmented, n_threads);
+  }
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+// Shortest path queries per second between random nodes of an R-MAT
+// graph: bidirectional BFS on the graph and on a csr_t, on several
+// threads, against a BFS from one end that allocates per query.
+//
+// Usage: path_bench [scale] [edge factor] [max threads] [queries]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <deque>
+#include <random>
+#include "graph.h"
+#include "csr.h"
+#include "path.h"
+#include "task_pool.h"
+#include "bench.h"
+#include "rmat.h"
+
+// BFS from u until v is reached, as src/main.cc does it.
+static int32_t bfs_query(const graph &g, const int32_t u, const int32_t v) {
+  std::vector<int32_t> dist(g.get_num_nodes(), -1);
+  std::deque<int32_t> queue;
+
+  dist[u] = 0;
+  queue.push_back(u);
+  while (!queue.empty()) {
+    int32_t x = queue.front();
+    queue.pop_front();
+    if (x == v) {
+      return dist[x];
+    }
+    g.for_each_adj(x, [&](int32_t y) {
+      if (dist[y] < 0) {
+        dist[y] = dist[x] + 1;
+        queue.push_back(y);
+      }
+    });
+  }
+  return -1;
+}
+
+// Run the queries on n_threads threads, each with a finder of its own.
+template <typename G>
+static void bench_finder(const G &g, const char *on,
+                         const std::vector<edge_t> &queries,
+                         const int n_threads) {
+  std::vector<path_finder_t<G>*> finders(n_threads);
+  std::vector<latency_t> latencies(n_threads);
+  std::vector<int64_t> visited(n_threads);
+  for (int i = 0; i < n_threads; ++i) {
+    finders[i] = new path_finder_t<G>(g);
+    latencies[i].reserve(queries.size());
+  }
+
+  uint64_t start = bench_now_ns();
+  parallel_for(queries.size(), n_threads,
+      [&](int tid, int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      uint64_t t = bench_now_ns();
+      finders[tid]->shortest_path(queries[i].first, queries[i].second);
+      latencies[tid].add(bench_now_ns() - t);
+      visited[tid] += finders[tid]->get_num_visited();
+    }
+  }, 16);
+  double seconds = (bench_now_ns() - start) * 1e-9;
+
+  int64_t total_visited = 0;
+  for (int i = 1; i < n_threads; ++i) {
+    latencies[0].merge(latencies[i]);
+  }
+  for (int i = 0; i < n_threads; ++i) {
+    total_visited += visited[i];
+    delete finders[i];
+  }
+
+  char extra[128];
+  snprintf(extra, sizeof(extra), ", \"on\": \"%s\", \"visited\": %ld",
+      on, (long)(total_visited / queries.size()));
+  bench_report("graph", "shortest_path", g.get_num_nodes(), n_threads,
+      queries.size(), seconds, latencies[0], extra);
+}
+
+int main(int argc, char *argv[])
+{
+  int scale = argc > 1 ? atoi(argv[1]) : 18;
+  int edge_factor = argc > 2 ? atoi(argv[2]) : 16;
+  int max_threads = argc > 3 ? atoi(argv[3]) : 4;
+  int n_queries = argc > 4 ? atoi(argv[4]) : 10000;
+
+  int32_t num_nodes = 1 << scale;
+  std::mt19937 rng(1);
+  graph g(num_nodes);
+  for (int64_t i = 0; i < (int64_t)num_nodes * edge_factor; ++i) {
+    int32_t from, to;
+    rmat_edge(scale, rng, from, to);
+    g.add_edge(from, to);
+  }
+  csr_t adj(g);
+
+  // R-MAT leaves many nodes without edges: queries are between others.
+  std::vector<edge_t> queries(n_queries);
+  for (auto &q : queries) {
+    do {
+      q.first = rng() % num_nodes;
+    } while (adj.get_degree(q.first) == 0);
+    do {
+      q.second = rng() % num_nodes;
+    } while (adj.get_degree(q.second) == 0);
+  }
+
+  // The baseline is slow, so it runs a few of the queries.
+  int n_bfs = std::min(n_queries, 100);
+  std::vector<int32_t> expected(n_bfs);
+  latency_t bfs_latency;
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < n_bfs; ++i) {
+    uint64_t t = bench_now_ns();
+    expected[i] = bfs_query(g, queries[i].first, queries[i].second);
+    bfs_latency.add(bench_now_ns() - t);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+  bench_report("graph", "bfs_query", num_nodes, 1, n_bfs, seconds,
+      bfs_latency);
+
+  // Paths must be as short as the baseline's, and made of edges.
+  path_finder_t<csr_t> finder(adj);
+  std::vector<int32_t> path;
+  for (int i = 0; i < n_bfs; ++i) {
+    int32_t d = finder.shortest_path(queries[i].first, queries[i].second,
+        &path);
+    bool ok = d == expected[i] && (int32_t)path.size() == d + 1;
+    for (int32_t k = 0; ok && k < d; ++k) {
+      ok = g.has_edge(path[k], path[k + 1]);
+    }
+    if (!ok || (d >= 0 && (path[0] != queries[i].first
+            || path[d] != queries[i].second))) {
+      fprintf(stderr, "path_bench: wrong path from %d to %d\n",
+          queries[i].first, queries[i].second);
+    }
+  }
+
+  for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+    bench_finder(g, "graph", queries, n_threads);
+    bench_finder(adj, "csr", queries, n_threads);
+  }
+
+  return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+// R-MAT of Chakrabarti et al., "R-MAT: A Recursive Model for Graph
+// Mining", SDM 2004, with the Graph500 probabilities.
+static void rmat_edge(int scale, std::mt19937 &rng, int32_t &from,
+                      int32_t &to) {
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  from = to = 0;
+  for (int i = 0; i < scale; ++i) {
+    double p = dist(rng);
+    int bit_from = p >= 0.57 + 0.19;
+    int bit_to = (p >= 0.57 && p < 0.57 + 0.19) || p >= 0.57 + 0.19 + 0.19;
+    from |= bit_from << i;
+    to |= bit_to << i;
+  }
+}
@@ -0,0 +1,149 @@
+// The task pool against a thread per task: the cost of a small
+// parallel_for(), as one level of a BFS or a short query pays it, then a
+// full BFS of an R-MAT graph level by level on the pool, against a BFS
+// on one thread.
+//
+// Usage: sched_bench [scale] [edge factor] [max threads]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <random>
+#include "graph.h"
+#include "csr.h"
+#include "bfs.h"
+#include "task_pool.h"
+#include "bench.h"
+#include "rmat.h"
+
+#define N_CALLS 10000
+
+// parallel_for() as it was before the task pool: a thread per task.
+template <typename F>
+static void thread_parallel_for(const int64_t n, const int n_threads, F f,
+                                const int64_t chunk) {
+  std::atomic<int64_t> next(0);
+  auto worker = [&](int tid) {
+    while (true) {
+      int64_t begin = next.fetch_add(chunk);
+      if (begin >= n) {
+        break;
+      }
+      f(tid, begin, std::min(begin + chunk, n));
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < n_threads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+// N_CALLS calls of a parallel_for() over n_threads small chunks. The
+// pool has a worker per thread but the caller's, whatever the machine.
+static void bench_calls(const char *on, const int n_threads) {
+  task_pool_t pool(n_threads - 1);
+  std::vector<int64_t> sums(n_threads * 8);
+  auto body = [&](int tid, int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      sums[tid * 8] += i;
+    }
+  };
+
+  latency_t latency;
+  latency.reserve(N_CALLS);
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < N_CALLS; ++i) {
+    uint64_t t = bench_now_ns();
+    if (on[0] == 'p') {
+      pool.parallel_for(n_threads * 64, n_threads, body, 64);
+    } else {
+      thread_parallel_for(n_threads * 64, n_threads, body, 64);
+    }
+    latency.add(bench_now_ns() - t);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+
+  char extra[64];
+  snprintf(extra, sizeof(extra), ", \"on\": \"%s\"", on);
+  bench_report("graph", "parallel_for", n_threads * 64, n_threads, N_CALLS,
+      seconds, latency, extra);
+}
+
+// BFS on one thread, with a queue, as src/main.cc does it.
+static std::vector<int32_t> BFS(const csr_t &g, const int32_t source) {
+  std::vector<int32_t> depth(g.get_num_nodes(), -1);
+  std::deque<int32_t> queue;
+
+  depth[source] = 0;
+  queue.push_back(source);
+  while (!queue.empty()) {
+    int32_t x = queue.front();
+    queue.pop_front();
+    g.for_each_adj(x, [&](int32_t y) {
+      if (depth[y] < 0) {
+        depth[y] = depth[x] + 1;
+        queue.push_back(y);
+      }
+    });
+  }
+  return depth;
+}
+
+int main(int argc, char *argv[])
+{
+  int scale = argc > 1 ? atoi(argv[1]) : 20;
+  int edge_factor = argc > 2 ? atoi(argv[2]) : 16;
+  int max_threads = argc > 3 ? atoi(argv[3]) : 4;
+
+  for (int n_threads = 2; n_threads <= max_threads; n_threads *= 2) {
+    bench_calls("threads", n_threads);
+    bench_calls("pool", n_threads);
+  }
+
+  int32_t num_nodes = 1 << scale;
+  std::mt19937 rng(1);
+  graph g(num_nodes);
+  for (int64_t i = 0; i < (int64_t)num_nodes * edge_factor; ++i) {
+    int32_t from, to;
+    rmat_edge(scale, rng, from, to);
+    g.add_edge(from, to);
+  }
+  csr_t adj(g);
+
+  // The node of highest degree, so that most of the graph is reached.
+  int32_t source = 0;
+  for (int32_t v = 0; v < num_nodes; ++v) {
+    if (adj.get_degree(v) > adj.get_degree(source)) {
+      source = v;
+    }
+  }
+
+  latency_t latency;
+  uint64_t start = bench_now_ns();
+  std::vector<int32_t> expected = BFS(adj, source);
+  latency.add(bench_now_ns() - start);
+  bench_report("graph", "bfs", num_nodes, 1, 1,
+      (bench_now_ns() - start) * 1e-9, latency);
+
+  for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+    latency_t parallel_latency;
+    start = bench_now_ns();
+    std::vector<int32_t> depth = parallel_bfs(adj, source, n_threads);
+    parallel_latency.add(bench_now_ns() - start);
+    bench_report("graph", "parallel_bfs", num_nodes, n_threads, 1,
+        (bench_now_ns() - start) * 1e-9, parallel_latency);
+
+    if (depth != expected) {
+      fprintf(stderr, "sched_bench: parallel_bfs differs from BFS\n");
+    }
+  }
+
+  return 0;
+}
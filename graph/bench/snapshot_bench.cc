@@ -0,0 +1,108 @@
+// Startup time of a graph read from text, as src/main.cc reads stdin,
+// against mapping a snapshot saved by graph::save(), on an R-MAT graph.
+// Startup ends with the first has_edge(). A BFS on both follows, the
+// first on the snapshot reading its pages in.
+// The files were just written, so they are in the page cache.
+//
+// Usage: snapshot_bench [scale] [edge factor] [directory for the files]
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include "graph.h"
+#include "snapshot.h"
+#include "bench.h"
+#include "rmat.h"
+#include "full_bfs.h"
+
+template <typename G>
+static int64_t bench_bfs(const G &g, const char *on, const int32_t source) {
+  latency_t latency;
+  uint64_t start = bench_now_ns();
+  int64_t reached = BFS(g, source);
+  latency.add(bench_now_ns() - start);
+
+  char extra[64];
+  snprintf(extra, sizeof(extra), ", \"on\": \"%s\"", on);
+  bench_report("graph", "bfs", g.get_num_nodes(), 1, 1,
+      (bench_now_ns() - start) * 1e-9, latency, extra);
+  return reached;
+}
+
+int main(int argc, char *argv[])
+{
+  int scale = argc > 1 ? atoi(argv[1]) : 18;
+  int edge_factor = argc > 2 ? atoi(argv[2]) : 16;
+  std::string dir = argc > 3 ? argv[3] : "/tmp";
+  std::string text_path = dir + "/graph_snapshot_bench.txt";
+  std::string snapshot_path = dir + "/graph_snapshot_bench.snap";
+
+  int32_t num_nodes = 1 << scale;
+  int64_t num_edges = (int64_t)num_nodes * edge_factor;
+  std::mt19937 rng(1);
+  edge_t first_edge;
+  {
+    // The input format of src/main.cc, with a single case.
+    std::ofstream text(text_path);
+    text << 1 << '\n' << num_nodes << '\n' << num_edges << '\n';
+    for (int64_t i = 0; i < num_edges; ++i) {
+      int32_t from, to;
+      rmat_edge(scale, rng, from, to);
+      text << from << ' ' << to << '\n';
+      if (i == 0) {
+        first_edge = edge_t(from, to);
+      }
+    }
+  }
+
+  // Parse and add edges.
+  latency_t text_latency;
+  uint64_t start = bench_now_ns();
+  int tc, num_node, num_edge;
+  std::ifstream in(text_path);
+  in >> tc >> num_node >> num_edge;
+  graph g(num_node);
+  for (int i = 0; i < num_edge; ++i) {
+    int from, to;
+    in >> from >> to;
+    g.add_edge(from, to);
+  }
+  bool found = g.has_edge(first_edge.first, first_edge.second);
+  text_latency.add(bench_now_ns() - start);
+  bench_report("graph", "startup_text", num_nodes, 1, 1,
+      (bench_now_ns() - start) * 1e-9, text_latency);
+
+  latency_t save_latency;
+  start = bench_now_ns();
+  bool saved = g.save(snapshot_path.c_str());
+  save_latency.add(bench_now_ns() - start);
+  bench_report("graph", "save", num_nodes, 1, 1,
+      (bench_now_ns() - start) * 1e-9, save_latency);
+
+  latency_t snapshot_latency;
+  start = bench_now_ns();
+  graph_snapshot_t snapshot;
+  bool opened = snapshot.open(snapshot_path.c_str());
+  found = found && snapshot.has_edge(first_edge.first, first_edge.second);
+  snapshot_latency.add(bench_now_ns() - start);
+  bench_report("graph", "startup_snapshot", num_nodes, 1, 1,
+      (bench_now_ns() - start) * 1e-9, snapshot_latency);
+
+  if (!saved || !opened || !found
+      || snapshot.get_num_edges() != 2 * num_edges) {
+    std::cerr << "snapshot_bench: snapshot differs from the graph"
+      << std::endl;
+  }
+
+  if (bench_bfs(g, "graph", first_edge.first)
+      != bench_bfs(snapshot, "snapshot", first_edge.first)) {
+    std::cerr << "snapshot_bench: BFS differs" << std::endl;
+  }
+
+  remove(text_path.c_str());
+  remove(snapshot_path.c_str());
+  return 0;
+}
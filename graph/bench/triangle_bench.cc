@@ -0,0 +1,78 @@
+// Triangle counting and k-core decomposition on an R-MAT graph,
+// whose skewed degrees are like those of a social graph.
+//
+// Usage: triangle_bench [scale] [edge factor] [max threads]
+// The graph has 2^scale nodes and edge factor * 2^scale edges.
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "graph.h"
+#include "csr.h"
+#include "triangle.h"
+#include "kcore.h"
+#include "bench.h"
+#include "rmat.h"
+
+#define N_RUNS 3
+
+int main(int argc, char *argv[])
+{
+  int scale = argc > 1 ? atoi(argv[1]) : 18;
+  int edge_factor = argc > 2 ? atoi(argv[2]) : 16;
+  int max_threads = argc > 3 ? atoi(argv[3]) : 4;
+
+  int32_t num_nodes = 1 << scale;
+  std::mt19937 rng(1);
+  graph g(num_nodes);
+  for (int64_t i = 0; i < (int64_t)num_nodes * edge_factor; ++i) {
+    int32_t from, to;
+    rmat_edge(scale, rng, from, to);
+    g.add_edge(from, to);
+  }
+
+  latency_t build_latency;
+  uint64_t start = bench_now_ns();
+  csr_t adj(g, 0, true);
+  double seconds = (bench_now_ns() - start) * 1e-9;
+  build_latency.add(bench_now_ns() - start);
+  bench_report("graph", "csr_build_simple", num_nodes, 1, 1, seconds,
+      build_latency);
+
+  for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+    char extra[128];
+    latency_t latency;
+    int64_t triangles = 0;
+
+    start = bench_now_ns();
+    for (int i = 0; i < N_RUNS; ++i) {
+      uint64_t t = bench_now_ns();
+      triangles = count_triangles(adj, n_threads);
+      latency.add(bench_now_ns() - t);
+    }
+    seconds = (bench_now_ns() - start) * 1e-9;
+    snprintf(extra, sizeof(extra), ", \"edges\": %ld, \"triangles\": %ld",
+        (long)adj.get_num_edges() / 2, (long)triangles);
+    bench_report("graph", "triangle_count", num_nodes, n_threads,
+        N_RUNS, seconds, latency, extra);
+
+    latency_t kcore_latency;
+    int32_t max_core = 0;
+
+    start = bench_now_ns();
+    for (int i = 0; i < N_RUNS; ++i) {
+      uint64_t t = bench_now_ns();
+      std::vector<int32_t> core = core_numbers(adj, n_threads);
+      kcore_latency.add(bench_now_ns() - t);
+      max_core = *std::max_element(core.begin(), core.end());
+    }
+    seconds = (bench_now_ns() - start) * 1e-9;
+    snprintf(extra, sizeof(extra), ", \"edges\": %ld, \"max_core\": %d",
+        (long)adj.get_num_edges() / 2, max_core);
+    bench_report("graph", "kcore", num_nodes, n_threads,
+        N_RUNS, seconds, kcore_latency, extra);
+  }
+
+  return 0;
+}
@@ -0,0 +1,116 @@
+// Random walk steps per second on an R-MAT graph, a walk of walk length
+// from every node: uniform, weighted by alias tables, and node2vec, on
+// several threads. Against walks that copy the adjacent nodes of every
+// node they step from with get_adj_nodes().
+//
+// Usage: walk_bench [scale] [edge factor] [max threads] [walk length]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <deque>
+#include <random>
+#include "graph.h"
+#include "csr.h"
+#include "walk.h"
+#include "bench.h"
+#include "rmat.h"
+
+// Walks of get_adj_nodes(), on this many starts only.
+#define N_COPY_WALKS 2000
+#define NODE2VEC_P 0.5f
+#define NODE2VEC_Q 2.0f
+
+static void bench_copy(graph &g, const int32_t walk_length) {
+  std::mt19937 rng(1);
+  latency_t latency;
+  int64_t n_steps = 0;
+
+  uint64_t start = bench_now_ns();
+  for (int32_t i = 0; i < N_COPY_WALKS; ++i) {
+    uint64_t t = bench_now_ns();
+    int32_t v = i;
+    for (int32_t step = 1; step < walk_length; ++step) {
+      std::deque<int32_t> adj_nodes = g.get_adj_nodes(v);
+      if (adj_nodes.empty()) {
+        break;
+      }
+      v = adj_nodes[rng() % adj_nodes.size()];
+      ++n_steps;
+    }
+    latency.add(bench_now_ns() - t);
+  }
+  double seconds = (bench_now_ns() - start) * 1e-9;
+
+  char extra[128];
+  snprintf(extra, sizeof(extra),
+      ", \"on\": \"get_adj_nodes\", \"steps\": %ld, \"steps_per_sec\": %.0f",
+      (long)n_steps, n_steps / seconds);
+  bench_report("graph", "random_walk", g.get_num_nodes(), 1, N_COPY_WALKS,
+      seconds, latency, extra);
+}
+
+// Ops are walks, latency is of a walk() of every start.
+static void bench_walker(const random_walker_t &walker, const char *on,
+                         const std::vector<int32_t> &starts,
+                         const int32_t walk_length, std::vector<int32_t> &out,
+                         const int n_threads) {
+  latency_t latency;
+  uint64_t t = bench_now_ns();
+  int64_t n_steps = walker.walk(starts.data(), starts.size(), walk_length,
+      out.data(), 1, n_threads);
+  latency.add(bench_now_ns() - t);
+  double seconds = (bench_now_ns() - t) * 1e-9;
+
+  char extra[160];
+  snprintf(extra, sizeof(extra),
+      ", \"on\": \"%s\", \"steps\": %ld, \"steps_per_sec\": %.0f"
+      ", \"steps_per_sec_per_thread\": %.0f", on, (long)n_steps,
+      n_steps / seconds, n_steps / seconds / n_threads);
+  bench_report("graph", "random_walk", starts.size(), n_threads,
+      starts.size(), seconds, latency, extra);
+}
+
+int main(int argc, char *argv[])
+{
+  int scale = argc > 1 ? atoi(argv[1]) : 18;
+  int edge_factor = argc > 2 ? atoi(argv[2]) : 16;
+  int max_threads = argc > 3 ? atoi(argv[3]) : 4;
+  int32_t walk_length = argc > 4 ? atoi(argv[4]) : 80;
+
+  int32_t num_nodes = 1 << scale;
+  std::mt19937 rng(1);
+  graph g(num_nodes);
+  for (int64_t i = 0; i < (int64_t)num_nodes * edge_factor; ++i) {
+    int32_t from, to;
+    rmat_edge(scale, rng, from, to);
+    g.add_edge(from, to);
+  }
+  csr_t adj(g, 0, true);
+
+  bench_copy(g, walk_length);
+
+  std::vector<int32_t> starts(num_nodes);
+  for (int32_t v = 0; v < num_nodes; ++v) {
+    starts[v] = v;
+  }
+  std::vector<int32_t> out((int64_t)num_nodes * walk_length);
+
+  random_walker_t walker(adj);
+  for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+    walker.set_uniform();
+    bench_walker(walker, "uniform", starts, walk_length, out, n_threads);
+
+    // Toward nodes of high degree, as for a walk weighted by edge counts.
+    walker.set_weights([&](int32_t, int32_t u) {
+      return (float)adj.get_degree(u);
+    }, n_threads);
+    bench_walker(walker, "alias", starts, walk_length, out, n_threads);
+
+    walker.set_uniform();
+    walker.set_node2vec(NODE2VEC_P, NODE2VEC_Q);
+    bench_walker(walker, "node2vec", starts, walk_length, out, n_threads);
+    walker.set_node2vec(1, 1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "task_pool.h"
+
+// Frontier nodes per chunk. Small, so a chunk holding a hub is one of
+// many, and the other tasks take the chunks after it.
+#define BFS_CHUNK 64
+
+/* Depth of each node from source by BFS, or -1 if it isn't reachable, on
+ * any read-only graph G with get_num_nodes() and for_each_adj(), e.g.
+ * graph, csr_t or compressed_graph_t.
+ *
+ * Level synchronous: each level is a parallel_for over the frontier on
+ * the task pool, so no thread is created per level or per query. A node
+ * is claimed by the compare and swap that sets its depth, and goes to the
+ * next frontier of the task that claimed it. */
+template <typename G>
+std::vector<int32_t> parallel_bfs(const G &g, const int32_t source,
+                                  const int n_threads = 1) {
+  std::vector<int32_t> depth(g.get_num_nodes(), -1);
+  std::vector<int32_t> frontier(1, source);
+  std::vector<std::vector<int32_t>> next(std::max(n_threads, 1));
+
+  depth[source] = 0;
+  for (int32_t level = 1; !frontier.empty(); ++level) {
+    parallel_for(frontier.size(), n_threads,
+        [&](int tid, int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        g.for_each_adj(frontier[i], [&](int32_t u) {
+          int32_t unvisited = -1;
+          if (__atomic_load_n(&depth[u], __ATOMIC_RELAXED) < 0
+              && __atomic_compare_exchange_n(&depth[u], &unvisited, level,
+                false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            next[tid].push_back(u);
+          }
+        });
+      }
+    }, BFS_CHUNK);
+
+    frontier.clear();
+    for (auto &nodes : next) {
+      frontier.insert(frontier.end(), nodes.begin(), nodes.end());
+      nodes.clear();
+    }
+  }
+  return depth;
+}
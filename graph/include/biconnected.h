@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "graph.h"
+#include "dfs.h"
+
+/* Bridges, articulation points and biconnected components, in one
+ * dfs_t::run_all() of any graph dfs_t takes (Tarjan, "Depth-first search
+ * and linear graph algorithms", 1972).
+ *
+ * low[v] is the smallest discovery order reached from the subtree of v
+ * by one back edge. An edge from p to a child v is a bridge if low[v] is
+ * above p, and v's subtree with p is a component if low[v] is not below
+ * p. Components are found as the nodes above v on a stack of discovered
+ * nodes, so low[], the stack and a cut flag are all it keeps per node,
+ * besides dfs_t's.
+ * A node without edges is in no component. */
+typedef struct biconnected {
+  std::vector<edge_t> bridges;               // (parent, child) in the DFS
+  std::vector<int32_t> articulation_points;  // by id
+  // Nodes of component c are nodes[offsets[c], offsets[c + 1]).
+  // An articulation point is in every component it joins.
+  std::vector<int64_t> offsets;
+  std::vector<int32_t> nodes;
+} biconnected_t;
+
+template <typename G>
+biconnected_t find_biconnected(const G &g) {
+  struct visitor_t : dfs_visitor_t {
+    const dfs_t<G> &dfs;
+    biconnected_t &result;
+    std::vector<int32_t> low;
+    std::vector<int32_t> stack;
+    std::vector<uint8_t> is_cut;
+    int32_t root;          // of the current DFS tree
+    int32_t root_children; // components of root
+
+    visitor_t (const dfs_t<G> &dfs, biconnected_t &result, int32_t n)
+      : dfs(dfs), result(result), low(n), is_cut(n), root(-1),
+        root_children(0) {
+      stack.reserve(n);
+    }
+
+    void discover(const int32_t v, const int32_t parent) {
+      low[v] = dfs.get_order(v);
+      stack.push_back(v);
+      if (parent < 0) {
+        root = v;
+        root_children = 0;
+      }
+    }
+
+    void back_edge(const int32_t v, const int32_t u) {
+      low[v] = std::min(low[v], dfs.get_order(u));
+    }
+
+    void finish(const int32_t v, const int32_t parent) {
+      if (parent < 0) {
+        // The root is a cut if it has two subtrees. It is left on the
+        // stack by its last component, or alone if it has none.
+        is_cut[v] = root_children > 1;
+        stack.pop_back();
+        return;
+      }
+
+      int32_t parent_order = dfs.get_order(parent);
+      low[parent] = std::min(low[parent], low[v]);
+      if (low[v] > parent_order) {
+        result.bridges.push_back(edge_t(parent, v));
+      }
+      if (low[v] >= parent_order) {
+        int32_t u;
+        do {
+          u = stack.back();
+          stack.pop_back();
+          result.nodes.push_back(u);
+        } while (u != v);
+        result.nodes.push_back(parent);
+        result.offsets.push_back(result.nodes.size());
+        if (parent == root) {
+          ++root_children;
+        } else {
+          is_cut[parent] = 1;
+        }
+      }
+    }
+  };
+
+  int32_t num_nodes = g.get_num_nodes();
+  biconnected_t result;
+  result.offsets.push_back(0);
+
+  dfs_t<G> dfs(g);
+  visitor_t visitor(dfs, result, num_nodes);
+  dfs.run_all(visitor);
+
+  for (int32_t v = 0; v < num_nodes; ++v) {
+    if (visitor.is_cut[v]) {
+      result.articulation_points.push_back(v);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "graph.h"
+
+/* Read-only graph whose adjacency is compressed, for graphs that don't fit
+ * in memory as deques or as a csr_t.
+ *
+ * The adjacent nodes of a node are sorted and stored as gaps: the first
+ * as its zigzag encoded difference to the node, the others as differences
+ * to the one before. Each gap is a varint of 7 bits a byte, low bits
+ * first, with the high bit set on all bytes but the last. Gaps of nearby
+ * nodes take a byte, as on graphs numbered by locality.
+ *
+ * Adjacent nodes are decoded on the fly by for_each_adj(), so traversals
+ * on graph, e.g. path_finder_t, take a compressed_graph_t as they are.
+ * Multi edges are kept, as gaps of 0. */
+class compressed_graph_t
+{
+public:
+  // From a graph, or from the edges of a graph of num_nodes nodes
+  // without building it. Edges with a node out of range are skipped, as
+  // by graph::apply_batch().
+  compressed_graph_t (const graph &g, const int n_threads = 1);
+  compressed_graph_t (const int32_t num_nodes,
+                      const std::vector<edge_t> &edges,
+                      const int n_threads = 1);
+
+  int32_t get_num_nodes() const;
+  int64_t get_num_edges() const; // adjacency entries, so twice the edges
+  int32_t get_degree(const int32_t node) const; // decodes the node
+  int64_t get_num_bytes() const; // of the adjacency and its offsets
+
+  // Call f(adj_node) for each node adjacent to node, in order.
+  template <typename F>
+  void for_each_adj(const int32_t node, F f) const {
+    const uint8_t *p = data.data() + offsets[node];
+    const uint8_t *end = data.data() + offsets[node + 1];
+    if (p == end) {
+      return;
+    }
+    uint32_t gap = read_varint(p);
+    int32_t adj_node = node + (int32_t)((gap >> 1) ^ -(gap & 1));
+    f(adj_node);
+    while (p != end) {
+      adj_node += read_varint(p);
+      f(adj_node);
+    }
+  }
+
+private:
+  int32_t num_nodes;
+  int64_t num_edges;
+  std::vector<int64_t> offsets; // of the adjacency of each node in data
+  std::vector<uint8_t> data;
+
+  static uint32_t read_varint(const uint8_t *&p) {
+    uint32_t value = *p & 0x7f;
+    for (int shift = 7; *p++ & 0x80; shift += 7) {
+      value |= (uint32_t)(*p & 0x7f) << shift;
+    }
+    return value;
+  }
+
+  template <typename A>
+  void encode(A get_adj, const int n_threads);
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "graph.h"
+
+/* Read-only copy of the adjacency of a graph in compressed sparse row form.
+ *
+ * Adjacent nodes of a node are contiguous, so kernels stream them
+ * instead of walking a deque per node.
+ * With segment_size > 0, the adjacency is split into segments by the id of
+ * the adjacent node, so that the part of a vector a segment reads fits in
+ * cache (CSR segmenting). A segment keeps only the nodes that have an
+ * adjacent node in it.
+ * With simple, adjacent nodes are sorted, and multi edges and self loops
+ * are dropped, as triangle counting and k-core expect. */
+class csr_t
+{
+public:
+  csr_t (const graph &g, const int32_t segment_size = 0,
+         const bool simple = false);
+
+  int32_t get_num_nodes() const;
+  int64_t get_num_edges() const; // adjacency entries, so twice the edges
+  int32_t get_degree(const int32_t node) const;
+  int32_t get_num_segments() const;
+
+  // Adjacent nodes of node. Only without segments.
+  const int32_t* adj_begin(const int32_t node) const;
+  const int32_t* adj_end(const int32_t node) const;
+
+  // Call f(adj_node) for each node adjacent to node, as graph does.
+  // Only without segments.
+  template <typename F>
+  void for_each_adj(const int32_t node, F f) const {
+    const int32_t *end = adj_end(node);
+    for (const int32_t *i = adj_begin(node); i != end; ++i) {
+      f(*i);
+    }
+  }
+
+  // y[v] = sum of x[u] over the nodes u adjacent to v.
+  void spmv(const float *x, float *y, const int n_threads) const;
+
+private:
+  typedef struct segment {
+    std::vector<int32_t> nodes;   // nodes having an adjacent node here
+    std::vector<int64_t> offsets; // of their adjacent nodes in adj
+    std::vector<int32_t> adj;
+  } segment_t;
+
+  int32_t num_nodes;
+  int64_t num_edges;
+  std::vector<int32_t> degree;
+  std::vector<segment_t> segments;
+};
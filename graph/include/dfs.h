@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "graph.h"
+
+/* Depth first search without recursion, so paths of any length fit, on
+ * graph or on a CSR graph with adj_begin() and adj_end(), e.g. csr_t or
+ * graph_snapshot_t.
+ *
+ * The stack is a flat array of frames, a node and the position in its
+ * adjacency to go on from, reserved for every node up front. Discovery
+ * order is an int32_t per node. Nothing else is allocated per node, so
+ * a DFS of n nodes takes 12 bytes a node, plus its visitor's.
+ *
+ * A visitor has
+ *   discover(v, parent)  when v is reached, parent is -1 at a root,
+ *   back_edge(v, u)      for an edge from v to an ancestor u of v,
+ *   finish(v, parent)    when the subtree of v is done.
+ * dfs_visitor_t has them all doing nothing, to inherit from.
+ * The graph is undirected: the edge to the parent is not a back edge,
+ * but a second edge to it is. Self loops are left out. */
+
+struct dfs_visitor_t {
+  void discover(const int32_t, const int32_t) {}
+  void back_edge(const int32_t, const int32_t) {}
+  void finish(const int32_t, const int32_t) {}
+};
+
+// The adjacency by position, as graph::get_adj_slot() has it.
+template <typename G>
+int64_t get_adj_slots(const G &g, const int32_t node) {
+  return g.adj_end(node) - g.adj_begin(node);
+}
+template <typename G>
+int32_t get_adj_slot(const G &g, const int32_t node, const int64_t i) {
+  return g.adj_begin(node)[i];
+}
+inline int64_t get_adj_slots(const graph &g, const int32_t node) {
+  return g.get_adj_slots(node);
+}
+inline int32_t get_adj_slot(const graph &g, const int32_t node,
+                            const int64_t i) {
+  return g.get_adj_slot(node, i);
+}
+
+template <typename G>
+class dfs_t
+{
+public:
+  dfs_t (const G &g) : g(g), num_visited(0), order(g.get_num_nodes(), -1) {
+    frames.reserve(g.get_num_nodes());
+  }
+
+  // DFS from root, skipping the nodes visited by earlier runs.
+  template <typename V>
+  void run(const int32_t root, V &visitor);
+
+  // DFS from every node not visited yet, in order of id, i.e. a DFS
+  // forest of the graph.
+  template <typename V>
+  void run_all(V &visitor) {
+    for (int32_t v = 0; v < (int32_t)order.size(); ++v) {
+      run(v, visitor);
+    }
+  }
+
+  // Discovery number of node over every run, from 0, or -1.
+  int32_t get_order(const int32_t node) const { return order[node]; }
+  int32_t get_num_visited() const { return num_visited; }
+
+private:
+  typedef struct frame {
+    int32_t node;
+    uint32_t next : 31;          // position in the adjacency of node
+    uint32_t skipped_parent : 1; // the edge to the parent is passed
+  } frame_t;
+
+  const G &g;
+  int32_t num_visited;
+  std::vector<int32_t> order;
+  std::vector<frame_t> frames;
+
+  template <typename V>
+  void push(const int32_t node, const int32_t parent, V &visitor) {
+    order[node] = num_visited++;
+    visitor.discover(node, parent);
+    frame_t frame = {node, 0, 0};
+    frames.push_back(frame);
+  }
+};
+
+template <typename G>
+template <typename V>
+void dfs_t<G>::run(const int32_t root, V &visitor) {
+  if (order[root] >= 0) {
+    return;
+  }
+
+  push(root, -1, visitor);
+  while (!frames.empty()) {
+    frame_t &frame = frames.back();
+    int32_t v = frame.node;
+    int32_t parent = frames.size() > 1 ? frames[frames.size() - 2].node : -1;
+    int64_t end = get_adj_slots(g, v);
+
+    int32_t child = -1;
+    while (frame.next < end) {
+      int32_t u = get_adj_slot(g, v, frame.next++);
+      if (u < 0 || u == v) {
+        continue;
+      } else if (order[u] < 0) {
+        child = u;
+        break;
+      } else if (u == parent && !frame.skipped_parent) {
+        frame.skipped_parent = 1;
+      } else if (order[u] < order[v]) {
+        visitor.back_edge(v, u);
+      }
+    }
+
+    // frame is gone once a child is pushed.
+    if (child >= 0) {
+      push(child, v, visitor);
+    } else {
+      frames.pop_back();
+      visitor.finish(v, parent);
+    }
+  }
+}
@@ -1,7 +1,10 @@
+#pragma once
+
 #include <vector>
 #include <deque>
 #include <cstdint>
 #include <iostream>
+#include <algorithm>
 
 /* By commenting below #define,
  * We can change implementation from adjacency list to adjacecny matrix
@@ -13,25 +16,106 @@
 /* Node names are integer.
  * If num_nodes is 10, then nodes are 0~9 */
 
+/* With sorted_adj, adjacent nodes of each node are kept sorted,
+ * so has_edge() is a binary search and set intersections are merges.
+ * add_edge() then inserts in the middle of a deque: for a bulk load,
+ * add edges unsorted and call sort_adj() once.
+ * The adjacency matrix is always sorted. */
+
+/* Deleted edges leave a tombstone, ~node, in the adjacency list instead of
+ * erasing from the middle of a deque. A tombstone sorts where node does,
+ * so sorted lists stay sorted. The list of a node is compacted once it
+ * has more tombstones than edges. */
+
+typedef std::pair<int32_t, int32_t> edge_t;
+
 class graph
 {
 public:
-  graph (const int32_t num_nodes);
+  graph (const int32_t num_nodes, const bool sorted_adj = false);
   bool add_edge(const int32_t from, const int32_t to);
   bool del_edge(const int32_t from, const int32_t to);
   bool has_edge(const int32_t from, const int32_t to);
   std::deque<int32_t> get_adj_nodes(const int32_t node);
   virtual ~graph ();
 
-  int32_t get_num_nodes();
+  int32_t get_num_nodes() const;
+  int32_t get_degree(const int32_t node) const;
+
+  void sort_adj(); // and keep them sorted from now on
+  bool is_sorted_adj() const;
+
+  // Delete then insert edges, grouped by node, on n_threads threads.
+  // Deletes are applied to the graph as it was before the batch.
+  // Unlike del_edge(), deleting a missing edge is not an error.
+  // Return the number of edges inserted and deleted.
+  int64_t apply_batch(const std::vector<edge_t> &inserts,
+                      const std::vector<edge_t> &deletes,
+                      const int n_threads = 1);
+  void compact(const int n_threads = 1); // drop every tombstone
+
+  // Write the graph to path, for graph_snapshot_t to map. See snapshot.h.
+  bool save(const char *path) const;
+
+  // Call f(adj_node) for each node adjacent to node.
+  // Unlike get_adj_nodes(), nothing is copied.
+  template <typename F>
+  void for_each_adj(const int32_t node, F f) const {
+#ifdef ADJACENCY_LIST
+    for (auto i : adj_list[node]) {
+      if (i >= 0) {
+        f(i);
+      }
+    }
+#else
+    const std::vector<bool>& to_nodes = adj_mat[node];
+    for (int32_t i = 0; i < (int32_t)to_nodes.size(); ++i) {
+      if (to_nodes[i]) {
+        f(i);
+      }
+    }
+#endif
+  }
+
+  // The adjacency of node by position, for traversals that leave a node
+  // and come back to it, e.g. DFS. A position without an adjacent node,
+  // a tombstone or a 0 of the matrix, reads as -1.
+  int64_t get_adj_slots(const int32_t node) const {
+#ifdef ADJACENCY_LIST
+    return adj_list[node].size();
+#else
+    return adj_mat[node].size();
+#endif
+  }
+  int32_t get_adj_slot(const int32_t node, const int64_t i) const {
+#ifdef ADJACENCY_LIST
+    return std::max(adj_list[node][i], -1);
+#else
+    return adj_mat[node][i] ? (int32_t)i : -1;
+#endif
+  }
 
 private:
   bool is_valid_node(const int32_t);
   int32_t num_nodes;
 
+  bool sorted_adj;
+
 #ifdef ADJACENCY_LIST
   std::vector< std::deque<int32_t> > adj_list;
+  std::vector<int32_t> num_dead; // tombstones in adj_list
+
+  std::deque<int32_t>::iterator find_adj(const int32_t from,
+                                         const int32_t to);
+  void compact_adj(const int32_t node);
 #else
   std::vector< std::vector<bool> > adj_mat;
 #endif
+
+  // Apply the updates of apply_batch() to the adjacent nodes of node.
+  // merged is room for a sorted list.
+  void apply_adj(const int32_t node, const uint64_t *updates,
+                 const int64_t n, std::vector<int32_t> &merged,
+                 int64_t &n_inserted, int64_t &n_deleted);
+  void prefetch_adj(const int32_t node, const bool ends) const;
 };
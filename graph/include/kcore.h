@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "csr.h"
+
+/* Core number of each node of a simple csr_t: the largest k such that
+ * the node is in a subgraph whose nodes all have k or more adjacent nodes
+ * in it.
+ *
+ * Nodes are peeled level by level, in parallel (ParK, Dasari et al.,
+ * "ParK: An Efficient Algorithm for k-core Decomposition on Multicore
+ * Processors", 2014): at level k, the remaining nodes with degree k or
+ * less are removed, which may bring adjacent nodes down to k in turn.
+ * Levels with no node are skipped. */
+std::vector<int32_t> core_numbers(const csr_t &adj, const int n_threads);
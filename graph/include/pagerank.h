@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "csr.h"
+
+/* PageRank by power iteration over the adjacency of a csr_t.
+ * Each iteration pulls ranks from adjacent nodes with csr_t::spmv().
+ * The graph is undirected, so a node passes its rank to its adjacent
+ * nodes in equal parts. The rank of a node without adjacent nodes is
+ * spread over every node. Ranks sum to 1. */
+class pagerank_t
+{
+public:
+  pagerank_t (const csr_t &adj, const float damping = 0.85f);
+
+  // Iterate until the L1 change of the ranks is below tolerance,
+  // or max_iterations are done. Return the number of iterations.
+  // Calling it again continues from the current ranks.
+  int run(const int max_iterations, const float tolerance,
+          const int n_threads);
+
+  float get_delta() const; // L1 change of the last iteration
+  const std::vector<float>& get_ranks() const;
+
+private:
+  const csr_t &adj;
+  float damping;
+  float delta;
+
+  std::vector<float> ranks;
+  std::vector<float> contrib; // rank / degree
+  std::vector<float> sums;    // of contrib over adjacent nodes
+};
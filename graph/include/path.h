@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+/* Point to point shortest paths by bidirectional BFS, on any read-only
+ * graph G with get_num_nodes() and for_each_adj(), e.g. graph or csr_t.
+ *
+ * A BFS runs from each end, a level at a time, always expanding the
+ * smaller frontier, and stops once they meet. On graphs of small
+ * diameter, each side then visits about the square root of the nodes a
+ * BFS from one end would.
+ *
+ * A path_finder_t is the scratch of one thread: queries on several
+ * threads need one each, on the same graph. Nodes are marked visited with
+ * the number of the query, so nothing is cleared or allocated between
+ * queries. */
+template <typename G>
+class path_finder_t
+{
+public:
+  path_finder_t (const G &g)
+    : g(g), query(0), mark(g.get_num_nodes()), parent(g.get_num_nodes()) {}
+
+  // Number of edges on a shortest path from u to v, or -1 if there is
+  // none. With path, it is set to the nodes of the path, u first.
+  int32_t shortest_path(const int32_t u, const int32_t v,
+                        std::vector<int32_t> *path = nullptr);
+
+  // Nodes visited by the last query, from both ends.
+  int64_t get_num_visited() const { return num_visited; }
+
+private:
+  const G &g;
+
+  // mark[x] is 2 * query + side if x was visited from side 0 (u) or 1 (v)
+  // in this query. parent[x] is the node x was visited from.
+  uint32_t query;
+  std::vector<uint32_t> mark;
+  std::vector<int32_t> parent;
+  std::vector<int32_t> frontier[2];
+  std::vector<int32_t> next;
+  int64_t num_visited;
+
+  void follow(int32_t x, std::vector<int32_t> &nodes) const;
+};
+
+template <typename G>
+int32_t path_finder_t<G>::shortest_path(const int32_t u, const int32_t v,
+                                        std::vector<int32_t> *path) {
+  if (path) {
+    path->clear();
+  }
+
+  // Marks of earlier queries are stale once query wraps around.
+  if (++query >= UINT32_MAX / 2) {
+    std::fill(mark.begin(), mark.end(), 0);
+    query = 1;
+  }
+  const uint32_t mine[2] = {2 * query, 2 * query + 1};
+
+  mark[u] = mine[0];
+  parent[u] = u;
+  frontier[0].assign(1, u);
+  num_visited = 1;
+  if (u == v) {
+    if (path) {
+      path->push_back(u);
+    }
+    return 0;
+  }
+  mark[v] = mine[1];
+  parent[v] = v;
+  frontier[1].assign(1, v);
+  num_visited = 2;
+
+  int32_t depth[2] = {0, 0};
+  int32_t meet_from = -1, meet_to = -1;
+
+  while (!frontier[0].empty() && !frontier[1].empty()) {
+    int side = frontier[0].size() <= frontier[1].size() ? 0 : 1;
+    next.clear();
+
+    for (auto x : frontier[side]) {
+      g.for_each_adj(x, [&](int32_t y) {
+        if (meet_from >= 0 || mark[y] == mine[side]) {
+          return;
+        }
+        if (mark[y] == mine[1 - side]) {
+          meet_from = x;
+          meet_to = y;
+          return;
+        }
+        mark[y] = mine[side];
+        parent[y] = x;
+        next.push_back(y);
+      });
+      if (meet_from >= 0) {
+        break;
+      }
+    }
+    num_visited += next.size();
+
+    if (meet_from >= 0) {
+      // The first meeting is on a shortest path: a node met earlier in
+      // the other BFS would have been met from this side before.
+      if (path) {
+        std::vector<int32_t> rest;
+        follow(meet_from, *path);
+        follow(meet_to, rest);
+        std::reverse(path->begin(), path->end());
+        path->insert(path->end(), rest.begin(), rest.end());
+        if (side == 1) {
+          std::reverse(path->begin(), path->end());
+        }
+      }
+      return depth[0] + depth[1] + 1;
+    }
+
+    frontier[side].swap(next);
+    ++depth[side];
+  }
+
+  return -1;
+}
+
+// Nodes from x back to the end its BFS started from.
+template <typename G>
+void path_finder_t<G>::follow(int32_t x, std::vector<int32_t> &nodes) const {
+  nodes.push_back(x);
+  while (parent[x] != x) {
+    x = parent[x];
+    nodes.push_back(x);
+  }
+}
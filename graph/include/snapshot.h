@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+/* Read-only graph mapped from a file written by graph::save().
+ *
+ * The file is a CSR used as it is: opening it costs a mmap and a pass
+ * that checks the offsets are within the file, and the adjacent nodes are
+ * read as traversals reach them. Their ids are trusted. After the header
+ * come num_nodes + 1 offsets, then the sorted adjacent nodes of each node.
+ * Offsets are indexes into the adjacent nodes, not pointers, so the file
+ * means the same wherever it is mapped.
+ * Integers are in the byte order of the machine that saved the file.
+ *
+ * It has the traversal API of graph, so e.g. path_finder_t takes it. */
+
+#define GRAPH_SNAPSHOT_MAGIC "GRPHSNP"
+#define GRAPH_SNAPSHOT_VERSION 1
+
+typedef struct graph_snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  int64_t num_nodes;
+  int64_t num_edges; // adjacency entries, so twice the edges
+} graph_snapshot_header_t;
+
+class graph_snapshot_t
+{
+public:
+  graph_snapshot_t ();
+  virtual ~graph_snapshot_t ();
+
+  bool open(const char *path); // false if path isn't a snapshot
+  void close();
+
+  int32_t get_num_nodes() const;
+  int64_t get_num_edges() const;
+  int32_t get_degree(const int32_t node) const;
+  bool has_edge(const int32_t from, const int32_t to) const;
+
+  const int32_t* adj_begin(const int32_t node) const {
+    return adj + offsets[node];
+  }
+  const int32_t* adj_end(const int32_t node) const {
+    return adj + offsets[node + 1];
+  }
+
+  // Call f(adj_node) for each node adjacent to node, in order.
+  template <typename F>
+  void for_each_adj(const int32_t node, F f) const {
+    const int32_t *end = adj_end(node);
+    for (const int32_t *i = adj_begin(node); i != end; ++i) {
+      f(*i);
+    }
+  }
+
+private:
+  void *map;
+  size_t map_size;
+  int32_t num_nodes;
+  int64_t num_edges;
+  const int64_t *offsets;
+  const int32_t *adj;
+
+  graph_snapshot_t (const graph_snapshot_t&) = delete;
+  graph_snapshot_t& operator=(const graph_snapshot_t&) = delete;
+};
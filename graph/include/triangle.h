@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "csr.h"
+
+/* Number of triangles, counted in parallel on a simple csr_t.
+ *
+ * Each node keeps only its adjacent nodes ranked above it by
+ * (degree, id), so a triangle is found once, from its lowest ranked node,
+ * and nodes of high degree get short lists. The list of a node is
+ * intersected with those of its nodes through a bitmap per thread of
+ * num_nodes bits, which beats merging sorted lists by several times.
+ *
+ * With per_node, per_node[v] is set to the number of triangles v is in,
+ * e.g. for the clustering coefficient of v. */
+int64_t count_triangles(const csr_t &adj, const int n_threads,
+                        std::vector<int64_t> *per_node = nullptr);
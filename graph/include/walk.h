@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "csr.h"
+#include "task_pool.h"
+
+// Walks a task advances together, a step of each at a time, so the cache
+// misses of one walk overlap with the others'.
+#define WALK_GROUP 16
+
+/* Random walks on a csr_t, as DeepWalk and node2vec sample them.
+ *
+ * A step draws the index of an adjacent node and reads it straight from
+ * the adjacency array of the csr_t. Steps are uniform unless weights are
+ * set, in which case they are drawn in O(1) from an alias table per node
+ * (Walker, 1977; built by Vose's method), stored next to the adjacency.
+ * node2vec's second order bias is applied by rejection (KnightKing, Yang
+ * et al., SOSP 2019): a node drawn as above is kept with probability
+ * bias / max_bias, so no table per edge pair is needed.
+ *
+ * Walks run on the task pool. Each has its own generator seeded by its
+ * index, so the walks are the same on any number of threads. */
+class random_walker_t
+{
+public:
+  // adj must be built without segments. A segmented csr_t is reported,
+  // and every walk on it stays at its start.
+  random_walker_t (const csr_t &adj);
+
+  // Step from v to u with probability proportional to weight(v, u) >= 0.
+  // A node whose weights are all 0 steps uniformly.
+  template <typename W>
+  void set_weights(W weight, const int n_threads = 1);
+  void set_uniform(); // drop the weights
+
+  // Bias a step from v, having come from t, to x by 1/p if x is t, 1 if
+  // x is adjacent to t, and 1/q otherwise, on top of the weights.
+  // Adjacency is tested by a binary search, so the csr_t must be simple.
+  // p = q = 1 is a first order walk. False, and nothing is set, unless
+  // p and q are above 0.
+  bool set_node2vec(const float p, const float q);
+
+  // Walk walk_length nodes from each of starts[0, n_walks), into
+  // out[i * walk_length, (i + 1) * walk_length) for walk i. A walk that
+  // reaches a node with no adjacent node is padded with -1.
+  // Return the number of steps taken, or -1, with nothing written, if a
+  // start is not a node.
+  int64_t walk(const int32_t *starts, const int64_t n_walks,
+               const int32_t walk_length, int32_t *out,
+               const uint64_t seed = 0, const int n_threads = 1) const;
+
+private:
+  const csr_t &adj;
+  const int32_t *adj_nodes;      // of the csr_t
+  std::vector<int64_t> offsets;  // of the adjacent nodes of each node
+
+  // Alias table of each node, by adjacency entry. Empty if uniform.
+  std::vector<float> prob;
+  std::vector<int32_t> alias;
+
+  bool second_order;
+  float return_bias, out_bias, max_bias, min_bias;
+
+  // The weights of node are in prob. Turn them into its alias table.
+  void build_alias(const int32_t node, std::vector<int32_t> &small,
+                   std::vector<int32_t> &large);
+  void walk_group(const int32_t *starts, const int64_t first,
+                  const int n, const int32_t walk_length, int32_t *out,
+                  const uint64_t seed, int64_t &n_steps) const;
+};
+
+template <typename W>
+void random_walker_t::set_weights(W weight, const int n_threads) {
+  int32_t num_nodes = adj.get_num_nodes();
+  prob.resize(offsets[num_nodes]);
+  alias.resize(offsets[num_nodes]);
+
+  parallel_for(num_nodes, n_threads, [&](int, int64_t begin, int64_t end) {
+    std::vector<int32_t> small, large;
+    for (int64_t v = begin; v < end; ++v) {
+      for (int64_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+        prob[i] = weight((int32_t)v, adj_nodes[i]);
+      }
+      build_alias(v, small, large);
+    }
+  });
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include "compressed.h"
+#include "task_pool.h"
+
+namespace {
+
+int varint_size(uint32_t value) {
+  int size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+void write_varint(uint32_t value, uint8_t *&p) {
+  while (value >= 0x80) {
+    *p++ = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  *p++ = value;
+}
+
+inline uint32_t zigzag(const int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+// Gaps of the sorted adjacent nodes of node, in order.
+template <typename F>
+void for_each_gap(const int32_t node, const std::vector<int32_t> &adj_nodes,
+                  F f) {
+  for (size_t i = 0; i < adj_nodes.size(); ++i) {
+    f(i == 0 ? zigzag(adj_nodes[0] - node)
+        : (uint32_t)(adj_nodes[i] - adj_nodes[i - 1]));
+  }
+}
+
+}
+
+// Two passes over the nodes on threads: one for the size of each node,
+// then, at offsets summed from them, one to write it.
+// get_adj(node, adj_nodes) fills adj_nodes with the sorted adjacent nodes.
+template <typename A>
+void compressed_graph_t::encode(A get_adj, const int n_threads) {
+  offsets.assign(num_nodes + 1, 0);
+
+  parallel_for(num_nodes, n_threads, [&](int, int64_t begin, int64_t end) {
+    std::vector<int32_t> adj_nodes;
+    for (int64_t v = begin; v < end; ++v) {
+      get_adj(v, adj_nodes);
+      int64_t size = 0;
+      for_each_gap(v, adj_nodes, [&](uint32_t gap) {
+        size += varint_size(gap);
+      });
+      offsets[v + 1] = size;
+    }
+  });
+
+  for (int32_t v = 0; v < num_nodes; ++v) {
+    offsets[v + 1] += offsets[v];
+  }
+  data.resize(offsets[num_nodes]);
+
+  parallel_for(num_nodes, n_threads, [&](int, int64_t begin, int64_t end) {
+    std::vector<int32_t> adj_nodes;
+    for (int64_t v = begin; v < end; ++v) {
+      get_adj(v, adj_nodes);
+      uint8_t *p = data.data() + offsets[v];
+      for_each_gap(v, adj_nodes, [&](uint32_t gap) {
+        write_varint(gap, p);
+      });
+      __atomic_fetch_add(&num_edges, (int64_t)adj_nodes.size(),
+          __ATOMIC_RELAXED);
+    }
+  });
+}
+
+compressed_graph_t::compressed_graph_t(const graph &g, const int n_threads)
+  : num_nodes(g.get_num_nodes()), num_edges(0) {
+  encode([&](int32_t v, std::vector<int32_t> &adj_nodes) {
+    adj_nodes.clear();
+    g.for_each_adj(v, [&](int32_t u) { adj_nodes.push_back(u); });
+    if (!g.is_sorted_adj()) {
+      std::sort(adj_nodes.begin(), adj_nodes.end());
+    }
+  }, n_threads);
+}
+
+compressed_graph_t::compressed_graph_t(const int32_t num_nodes,
+                                       const std::vector<edge_t> &edges,
+                                       const int n_threads)
+  : num_nodes(num_nodes), num_edges(0) {
+  auto is_valid = [&](const edge_t &e) {
+    return e.first >= 0 && e.first < num_nodes
+      && e.second >= 0 && e.second < num_nodes;
+  };
+
+  // Adjacent nodes in CSR form by counting sort, as add_edge() would
+  // add them: both ways.
+  std::vector<int64_t> starts(num_nodes + 1);
+  for (auto &e : edges) {
+    if (!is_valid(e)) {
+      continue;
+    }
+    ++starts[e.first + 1];
+    ++starts[e.second + 1];
+  }
+  for (int32_t v = 0; v < num_nodes; ++v) {
+    starts[v + 1] += starts[v];
+  }
+  std::vector<int32_t> adj(starts[num_nodes]);
+  {
+    std::vector<int64_t> next(starts.begin(), starts.end() - 1);
+    for (auto &e : edges) {
+      if (!is_valid(e)) {
+        continue;
+      }
+      adj[next[e.first]++] = e.second;
+      adj[next[e.second]++] = e.first;
+    }
+  }
+
+  encode([&](int32_t v, std::vector<int32_t> &adj_nodes) {
+    adj_nodes.assign(adj.begin() + starts[v], adj.begin() + starts[v + 1]);
+    std::sort(adj_nodes.begin(), adj_nodes.end());
+  }, n_threads);
+}
+
+int32_t compressed_graph_t::get_num_nodes() const {
+  return num_nodes;
+}
+
+int64_t compressed_graph_t::get_num_edges() const {
+  return num_edges;
+}
+
+// The last byte of each varint has the high bit clear.
+int32_t compressed_graph_t::get_degree(const int32_t node) const {
+  int32_t degree = 0;
+  for (int64_t i = offsets[node]; i < offsets[node + 1]; ++i) {
+    degree += data[i] < 0x80;
+  }
+  return degree;
+}
+
+int64_t compressed_graph_t::get_num_bytes() const {
+  return data.size() + offsets.size() * sizeof(int64_t);
+}
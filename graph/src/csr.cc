@@ -0,0 +1,136 @@
+#include <cassert>
+#include <algorithm>
+#include "csr.h"
+#include "task_pool.h"
+
+namespace {
+
+// Adjacent nodes of v, sorted if sort, and simple if simple.
+void get_adj(const graph &g, const int32_t v, const bool sort,
+             const bool simple, std::vector<int32_t> &adj_nodes) {
+  adj_nodes.clear();
+  g.for_each_adj(v, [&](int32_t u) { adj_nodes.push_back(u); });
+
+  if (sort && !g.is_sorted_adj()) {
+    std::sort(adj_nodes.begin(), adj_nodes.end());
+  }
+  if (simple) {
+    adj_nodes.erase(std::unique(adj_nodes.begin(), adj_nodes.end()),
+        adj_nodes.end());
+    adj_nodes.erase(std::remove(adj_nodes.begin(), adj_nodes.end(), v),
+        adj_nodes.end());
+  }
+}
+
+}
+
+csr_t::csr_t(const graph &g, const int32_t segment_size, const bool simple) {
+  num_nodes = g.get_num_nodes();
+  num_edges = 0;
+  degree.resize(num_nodes);
+
+  std::vector<int32_t> adj_nodes;
+
+  if (segment_size <= 0 || segment_size >= num_nodes) {
+    // A single segment of every node.
+    segments.resize(1);
+    segment_t &seg = segments[0];
+    seg.nodes.resize(num_nodes);
+    seg.offsets.reserve(num_nodes + 1);
+    seg.offsets.push_back(0);
+
+    for (int32_t v = 0; v < num_nodes; ++v) {
+      get_adj(g, v, simple, simple, adj_nodes);
+      seg.nodes[v] = v;
+      seg.adj.insert(seg.adj.end(), adj_nodes.begin(), adj_nodes.end());
+      seg.offsets.push_back(seg.adj.size());
+      degree[v] = adj_nodes.size();
+    }
+    num_edges = seg.adj.size();
+    return;
+  }
+
+  segments.resize((num_nodes + segment_size - 1) / segment_size);
+  for (auto &seg : segments) {
+    seg.offsets.push_back(0);
+  }
+
+  // Sorted adjacent nodes of a node fall into segments in runs.
+  for (int32_t v = 0; v < num_nodes; ++v) {
+    get_adj(g, v, true, simple, adj_nodes);
+    degree[v] = adj_nodes.size();
+    num_edges += adj_nodes.size();
+
+    for (size_t i = 0; i < adj_nodes.size(); ) {
+      segment_t &seg = segments[adj_nodes[i] / segment_size];
+      int32_t end = (adj_nodes[i] / segment_size + 1) * segment_size;
+
+      seg.nodes.push_back(v);
+      for (; i < adj_nodes.size() && adj_nodes[i] < end; ++i) {
+        seg.adj.push_back(adj_nodes[i]);
+      }
+      seg.offsets.push_back(seg.adj.size());
+    }
+  }
+}
+
+int32_t csr_t::get_num_nodes() const {
+  return num_nodes;
+}
+
+int64_t csr_t::get_num_edges() const {
+  return num_edges;
+}
+
+int32_t csr_t::get_degree(const int32_t node) const {
+  return degree[node];
+}
+
+int32_t csr_t::get_num_segments() const {
+  return segments.size();
+}
+
+const int32_t* csr_t::adj_begin(const int32_t node) const {
+  assert(segments.size() == 1);
+  return segments[0].adj.data() + segments[0].offsets[node];
+}
+
+const int32_t* csr_t::adj_end(const int32_t node) const {
+  assert(segments.size() == 1);
+  return segments[0].adj.data() + segments[0].offsets[node + 1];
+}
+
+void csr_t::spmv(const float *x, float *y, const int n_threads) const {
+  // A single segment has every node, so it writes y as a whole.
+  bool accumulate = segments.size() > 1;
+
+  if (accumulate) {
+    parallel_for(num_nodes, n_threads,
+        [&](int, int64_t begin, int64_t end) {
+      std::fill(y + begin, y + end, 0.0f);
+    }, 1 << 16);
+  }
+
+  // Threads take different nodes of a segment, so they never write
+  // the same element of y.
+  for (const auto &seg : segments) {
+    const int32_t *nodes = seg.nodes.data();
+    const int64_t *offsets = seg.offsets.data();
+    const int32_t *adj = seg.adj.data();
+
+    parallel_for(seg.nodes.size(), n_threads,
+        [&](int, int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        float sum = 0.0f;
+        for (int64_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+          sum += x[adj[k]];
+        }
+        if (accumulate) {
+          y[nodes[i]] += sum;
+        } else {
+          y[nodes[i]] = sum;
+        }
+      }
+    });
+  }
+}
@@ -1,9 +1,127 @@
 #include "graph.h"
+#include "task_pool.h"
 
-graph::graph(const int32_t num_nodes) {
+namespace {
+
+// Node of an adjacency list entry, which may be a tombstone.
+inline int32_t adj_node(const int32_t i) {
+  return i < 0 ? ~i : i;
+}
+
+inline bool adj_less(const int32_t a, const int32_t b) {
+  return adj_node(a) < adj_node(b);
+}
+
+// An update of apply_batch() is a key of (node, insert, adjacent node),
+// so sorting groups updates by node, deletes first.
+const uint64_t INSERT_BIT = 1ull << 32;
+const uint64_t NO_UPDATE = ~0ull;
+
+inline uint64_t update_key(const int32_t node, const int32_t adj,
+                           const bool insert) {
+  return (uint64_t)node << 33 | (insert ? INSERT_BIT : 0) | (uint32_t)adj;
+}
+
+inline int32_t update_node(const uint64_t key) {
+  return key >> 33;
+}
+
+inline int32_t update_adj(const uint64_t key) {
+  return (uint32_t)key;
+}
+
+// Deletes of a node up to which each is looked for by a scan of the list.
+#define SCAN_DELETES 8
+
+// Inserts to a sorted list above which it is merged with them instead.
+#define MERGE_INSERTS 8
+
+// Nodes whose lists are prefetched ahead of the node updated.
+#define PREFETCH_NODES 4
+
+// Keys below which std::sort beats a radix sort.
+#define RADIX_MIN 1024
+
+// LSD radix sort by bytes into tmp and back. A byte equal in every key
+// takes no pass, so only the bytes of node ids in use do.
+void radix_sort(uint64_t *keys, uint64_t *tmp, const int64_t n) {
+  if (n < RADIX_MIN) {
+    std::sort(keys, keys + n);
+    return;
+  }
+
+  std::vector<int64_t> counts(8 * 256);
+  for (int64_t i = 0; i < n; ++i) {
+    for (int b = 0; b < 8; ++b) {
+      ++counts[b * 256 + (keys[i] >> (8 * b) & 255)];
+    }
+  }
+
+  uint64_t *from = keys, *to = tmp;
+  for (int b = 0; b < 8; ++b) {
+    int64_t *count = counts.data() + b * 256;
+    if (count[keys[0] >> (8 * b) & 255] == n) {
+      continue;
+    }
+    int64_t offset = 0;
+    for (int d = 0; d < 256; ++d) {
+      int64_t c = count[d];
+      count[d] = offset;
+      offset += c;
+    }
+    for (int64_t i = 0; i < n; ++i) {
+      to[count[from[i] >> (8 * b) & 255]++] = from[i];
+    }
+    std::swap(from, to);
+  }
+
+  if (from != keys) {
+    std::copy(from, from + n, keys);
+  }
+}
+
+// Sort a run of keys per thread, then merge pairs of runs on threads.
+void parallel_sort(std::vector<uint64_t> &keys, const int n_threads) {
+  int64_t n = keys.size();
+  int64_t run = (n + std::max(n_threads, 1) - 1) / std::max(n_threads, 1);
+  std::vector<uint64_t> tmp(n);
+
+  if (n_threads <= 1 || run < RADIX_MIN) {
+    radix_sort(keys.data(), tmp.data(), n);
+    return;
+  }
+
+  parallel_for(n_threads, n_threads, [&](int, int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      int64_t first = std::min(i * run, n);
+      radix_sort(keys.data() + first, tmp.data() + first,
+          std::min((i + 1) * run, n) - first);
+    }
+  }, 1);
+
+  for (; run < n; run *= 2) {
+    int64_t n_pairs = (n + 2 * run - 1) / (2 * run);
+    parallel_for(n_pairs, n_threads, [&](int, int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        int64_t first = i * 2 * run;
+        std::merge(keys.begin() + first,
+            keys.begin() + std::min(first + run, n),
+            keys.begin() + std::min(first + run, n),
+            keys.begin() + std::min(first + 2 * run, n),
+            tmp.begin() + first);
+      }
+    }, 1);
+    keys.swap(tmp);
+  }
+}
+}
+
+graph::graph(const int32_t num_nodes, const bool sorted_adj) {
   this->num_nodes = num_nodes;
+  this->sorted_adj = sorted_adj;
 #ifdef ADJACENCY_LIST
   adj_list.resize(num_nodes);
+  num_dead.resize(num_nodes);
 #else
   adj_mat.resize(num_nodes);
   for (auto& i : adj_mat) {
@@ -31,8 +149,17 @@ bool graph::add_edge(const int32_t from, const int32_t to){
     return false;
   }
 #ifdef ADJACENCY_LIST
-  adj_list[from].push_back(to);
-  adj_list[to].push_back(from);
+  if (sorted_adj) {
+    auto &from_adj = adj_list[from];
+    from_adj.insert(std::upper_bound(from_adj.begin(), from_adj.end(), to,
+          adj_less), to);
+    auto &to_adj = adj_list[to];
+    to_adj.insert(std::upper_bound(to_adj.begin(), to_adj.end(), from,
+          adj_less), from);
+  } else {
+    adj_list[from].push_back(to);
+    adj_list[to].push_back(from);
+  }
 #else
   adj_mat[from][to] = true;
   adj_mat[to][from] = true;
@@ -42,33 +169,29 @@ bool graph::add_edge(const int32_t from, const int32_t to){
 
 bool graph::del_edge(const int32_t from, const int32_t to){
 #ifdef ADJACENCY_LIST
-  auto it = adj_list[from].begin();
-  for (;
-        it != adj_list[from].end(); ++it) {
-    if (*it == to) {
-      adj_list[from].erase(it);
-      break;
-    }
-  }
-
+  auto it = find_adj(from, to);
   if (it == adj_list[from].end()) {
     std::cerr << "(del_node) no edge ( " << from << ", " << to
       << ") to be deleted" << std::endl;
     return false;
   }
+  *it = ~to;
+  ++num_dead[from];
 
-  for (it = adj_list[to].begin(); it != adj_list[to].end(); ++it) {
-    if (*it == from) {
-      adj_list[to].erase(it);
-      break;
-    }
-  }
-
+  it = find_adj(to, from);
   if (it == adj_list[to].end()) {
     std::cerr << "(del_node) no edge ( " << to << ", " << from
       << ") to be deleted" << std::endl;
     return false;
   }
+  *it = ~from;
+  ++num_dead[to];
+
+  for (auto node : {from, to}) {
+    if (2 * num_dead[node] > (int32_t)adj_list[node].size()) {
+      compact_adj(node);
+    }
+  }
 #else
   if (adj_mat[from][to] == false || adj_mat[to][from] == false) {
     std::cerr << "(del_node) no edge to be deleted" << std::endl;
@@ -84,14 +207,7 @@ bool graph::del_edge(const int32_t from, const int32_t to){
 
 bool graph::has_edge(const int32_t from, const int32_t to){
 #ifdef ADJACENCY_LIST
-  for (auto it = adj_list[from].begin();
-        it != adj_list[from].end();
-        ++it) {
-    if (*it == to) {
-      return true;
-    }
-  }
-  return false;
+  return find_adj(from, to) != adj_list[from].end();
 #else
   return adj_mat[from][to];
 #endif
@@ -99,7 +215,12 @@ bool graph::has_edge(const int32_t from, const int32_t to){
 
 std::deque<int32_t> graph::get_adj_nodes(const int32_t node) {
 #ifdef ADJACENCY_LIST
-  return adj_list[node];
+  if (num_dead[node] == 0) {
+    return adj_list[node];
+  }
+  std::deque<int32_t> adj_nodes;
+  for_each_adj(node, [&](int32_t i) { adj_nodes.push_back(i); });
+  return adj_nodes;
 #else
   std::deque<int32_t> adj_nodes;
 
@@ -114,10 +235,280 @@ std::deque<int32_t> graph::get_adj_nodes(const int32_t node) {
 #endif
 }
 
-int32_t graph::get_num_nodes() {
+#ifdef ADJACENCY_LIST
+// Binary search if sorted, linear scan otherwise.
+// Tombstones never compare equal to a node.
+std::deque<int32_t>::iterator graph::find_adj(const int32_t from,
+                                              const int32_t to) {
+  auto &adj = adj_list[from];
+  if (sorted_adj) {
+    auto it = std::lower_bound(adj.begin(), adj.end(), to, adj_less);
+    while (it != adj.end() && *it == ~to) {
+      ++it;
+    }
+    return it != adj.end() && *it == to ? it : adj.end();
+  }
+  return std::find(adj.begin(), adj.end(), to);
+}
+
+void graph::compact_adj(const int32_t node) {
+  auto &adj = adj_list[node];
+  adj.erase(std::remove_if(adj.begin(), adj.end(),
+        [](int32_t i) { return i < 0; }), adj.end());
+  num_dead[node] = 0;
+}
+
+void graph::apply_adj(const int32_t node, const uint64_t *updates,
+                      const int64_t n, std::vector<int32_t> &merged,
+                      int64_t &n_inserted, int64_t &n_deleted) {
+  auto &adj = adj_list[node];
+  int64_t n_deletes = std::lower_bound(updates, updates + n,
+      update_key(node, 0, true)) - updates;
+
+  if (sorted_adj && n - n_deletes > MERGE_INSERTS) {
+    // A single merge of the list with the updates, which drops deleted
+    // nodes and tombstones. Deletes only match nodes already there.
+    merged.clear();
+    int64_t i = 0, j = n_deletes;
+    for (auto x : adj) {
+      if (x < 0) {
+        continue;
+      }
+      while (i < n_deletes && update_adj(updates[i]) < x) {
+        ++i;
+      }
+      if (i < n_deletes && update_adj(updates[i]) == x) {
+        ++i;
+        ++n_deleted;
+        continue;
+      }
+      for (; j < n && update_adj(updates[j]) < x; ++j) {
+        merged.push_back(update_adj(updates[j]));
+      }
+      merged.push_back(x);
+    }
+    for (; j < n; ++j) {
+      merged.push_back(update_adj(updates[j]));
+    }
+    adj.assign(merged.begin(), merged.end());
+    num_dead[node] = 0;
+    n_inserted += n - n_deletes;
+    return;
+  }
+
+  if (sorted_adj) {
+    // Deletes are sorted too, so each search starts after the last one.
+    auto it = adj.begin();
+    for (int64_t i = 0; i < n_deletes; ++i) {
+      int32_t to = update_adj(updates[i]);
+      it = std::lower_bound(it, adj.end(), to, adj_less);
+      while (it != adj.end() && *it == ~to) {
+        ++it;
+      }
+      if (it != adj.end() && *it == to) {
+        *it++ = ~to;
+        ++num_dead[node];
+        ++n_deleted;
+      }
+    }
+  } else if (n_deletes <= SCAN_DELETES) {
+    for (int64_t i = 0; i < n_deletes; ++i) {
+      int32_t to = update_adj(updates[i]);
+      auto it = std::find(adj.begin(), adj.end(), to);
+      if (it != adj.end()) {
+        *it = ~to;
+        ++num_dead[node];
+        ++n_deleted;
+      }
+    }
+  } else {
+    // A single scan of the list, looking up each node in the deletes.
+    std::vector<bool> done(n_deletes);
+    int64_t left = n_deletes;
+    for (auto it = adj.begin(); it != adj.end() && left; ++it) {
+      if (*it < 0) {
+        continue;
+      }
+      int64_t i = std::lower_bound(updates, updates + n_deletes,
+          update_key(node, *it, false)) - updates;
+      while (i < n_deletes && done[i] && update_adj(updates[i]) == *it) {
+        ++i;
+      }
+      if (i < n_deletes && update_adj(updates[i]) == *it) {
+        done[i] = true;
+        --left;
+        *it = ~*it;
+        ++num_dead[node];
+        ++n_deleted;
+      }
+    }
+  }
+
+  for (int64_t i = n_deletes; i < n; ++i) {
+    int32_t to = update_adj(updates[i]);
+    if (sorted_adj) {
+      adj.insert(std::upper_bound(adj.begin(), adj.end(), to, adj_less), to);
+    } else {
+      adj.push_back(to);
+    }
+  }
+  n_inserted += n - n_deletes;
+
+  if (2 * num_dead[node] > (int32_t)adj.size()) {
+    compact_adj(node);
+  }
+}
+#else
+void graph::apply_adj(const int32_t node, const uint64_t *updates,
+                      const int64_t n, std::vector<int32_t> &,
+                      int64_t &n_inserted, int64_t &n_deleted) {
+  std::vector<bool>& to_nodes = adj_mat[node];
+
+  for (int64_t i = 0; i < n; ++i) {
+    int32_t to = update_adj(updates[i]);
+    if (updates[i] & INSERT_BIT) {
+      to_nodes[to] = true;
+      ++n_inserted;
+    } else if (to_nodes[to]) {
+      to_nodes[to] = false;
+      // A self loop has two updates here, but a single entry.
+      n_deleted += to == node ? 2 : 1;
+    }
+  }
+}
+#endif
+
+int64_t graph::apply_batch(const std::vector<edge_t> &inserts,
+                           const std::vector<edge_t> &deletes,
+                           const int n_threads) {
+  // Both directions of each edge, or NO_UPDATE for an invalid node.
+  int64_t n_updates = inserts.size() + deletes.size();
+  std::vector<uint64_t> keys(2 * n_updates);
+
+  parallel_for(n_updates, n_threads, [&](int, int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      bool insert = i >= (int64_t)deletes.size();
+      const edge_t &e = insert ? inserts[i - deletes.size()] : deletes[i];
+      if (e.first < 0 || e.first >= num_nodes
+          || e.second < 0 || e.second >= num_nodes) {
+        keys[2 * i] = keys[2 * i + 1] = NO_UPDATE;
+      } else {
+        keys[2 * i] = update_key(e.first, e.second, insert);
+        keys[2 * i + 1] = update_key(e.second, e.first, insert);
+      }
+    }
+  }, 1 << 16);
+
+  parallel_sort(keys, n_threads);
+  keys.erase(std::lower_bound(keys.begin(), keys.end(), NO_UPDATE),
+      keys.end());
+
+  // Updates of the i-th node updated are in [starts[i], starts[i + 1]).
+  std::vector<int64_t> starts;
+  for (int64_t i = 0; i < (int64_t)keys.size(); ++i) {
+    if (i == 0 || update_node(keys[i]) != update_node(keys[i - 1])) {
+      starts.push_back(i);
+    }
+  }
+  starts.push_back(keys.size());
+
+  // Each node is updated by a single thread.
+  // The lists of nodes are scattered, so they are prefetched ahead.
+  std::vector<padded_t<int64_t> > n_inserted(std::max(n_threads, 1));
+  std::vector<padded_t<int64_t> > n_deleted(std::max(n_threads, 1));
+  parallel_for(starts.size() - 1, n_threads,
+      [&](int tid, int64_t begin, int64_t end) {
+    std::vector<int32_t> merged;
+    for (int64_t i = begin; i < end; ++i) {
+      if (i + 2 * PREFETCH_NODES < end) {
+        prefetch_adj(update_node(keys[starts[i + 2 * PREFETCH_NODES]]),
+            false);
+      }
+      if (i + PREFETCH_NODES < end) {
+        prefetch_adj(update_node(keys[starts[i + PREFETCH_NODES]]), true);
+      }
+      apply_adj(update_node(keys[starts[i]]), keys.data() + starts[i],
+          starts[i + 1] - starts[i], merged, n_inserted[tid].value,
+          n_deleted[tid].value);
+    }
+  }, 64);
+
+  // Each edge was counted once per direction.
+  int64_t n_applied = 0;
+  for (int i = 0; i < (int)n_inserted.size(); ++i) {
+    n_applied += n_inserted[i].value + n_deleted[i].value;
+  }
+  return n_applied / 2;
+}
+
+// Prefetch what apply_adj() reads first: the list of node, then,
+// once it is in cache, its ends.
+void graph::prefetch_adj(const int32_t node, const bool ends) const {
+#ifdef ADJACENCY_LIST
+  const auto &adj = adj_list[node];
+  if (!ends) {
+    __builtin_prefetch(&adj);
+    __builtin_prefetch(&num_dead[node]);
+  } else if (!adj.empty()) {
+    __builtin_prefetch(&adj.front());
+    __builtin_prefetch(&adj.back());
+  }
+#else
+  if (!ends) {
+    __builtin_prefetch(&adj_mat[node]);
+  }
+#endif
+}
+
+void graph::compact(const int n_threads) {
+#ifdef ADJACENCY_LIST
+  parallel_for(num_nodes, n_threads, [&](int, int64_t begin, int64_t end) {
+    for (int64_t node = begin; node < end; ++node) {
+      if (num_dead[node]) {
+        compact_adj(node);
+      }
+    }
+  });
+#else
+  (void)n_threads;
+#endif
+}
+
+void graph::sort_adj() {
+#ifdef ADJACENCY_LIST
+  if (!sorted_adj) {
+    for (auto &adj : adj_list) {
+      std::sort(adj.begin(), adj.end(), adj_less);
+    }
+  }
+#endif
+  sorted_adj = true;
+}
+
+bool graph::is_sorted_adj() const {
+#ifdef ADJACENCY_LIST
+  return sorted_adj;
+#else
+  return true;
+#endif
+}
+
+int32_t graph::get_num_nodes() const {
   return num_nodes;
 }
 
+int32_t graph::get_degree(const int32_t node) const {
+#ifdef ADJACENCY_LIST
+  return adj_list[node].size() - num_dead[node];
+#else
+  int32_t degree = 0;
+  for (auto i : adj_mat[node]) {
+    degree += i;
+  }
+  return degree;
+#endif
+}
+
 graph::~graph() {
 
 }
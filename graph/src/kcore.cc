@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <climits>
+#include "kcore.h"
+#include "task_pool.h"
+
+namespace {
+
+// Nodes found by each thread, joined after a parallel_for.
+std::vector<int32_t> join(std::vector< std::vector<int32_t> > &bufs) {
+  std::vector<int32_t> all;
+  for (auto &buf : bufs) {
+    all.insert(all.end(), buf.begin(), buf.end());
+    buf.clear();
+  }
+  return all;
+}
+
+}
+
+std::vector<int32_t> core_numbers(const csr_t &adj, const int n_threads) {
+  int32_t num_nodes = adj.get_num_nodes();
+
+  // Degree in the remaining subgraph. core is -1 until a node is removed.
+  std::vector<int32_t> degree(num_nodes);
+  std::vector<int32_t> core(num_nodes, -1);
+  std::vector<int32_t> remaining(num_nodes);
+  for (int32_t v = 0; v < num_nodes; ++v) {
+    degree[v] = adj.get_degree(v);
+    remaining[v] = v;
+  }
+
+  std::vector< std::vector<int32_t> > bufs(std::max(n_threads, 1));
+  std::vector<int32_t> min_degree(std::max(n_threads, 1));
+  int32_t k = 0;
+
+  while (!remaining.empty()) {
+    parallel_for(remaining.size(), n_threads,
+        [&](int tid, int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        if (degree[remaining[i]] <= k) {
+          bufs[tid].push_back(remaining[i]);
+        }
+      }
+    });
+    std::vector<int32_t> frontier = join(bufs);
+
+    for (auto v : frontier) {
+      core[v] = k;
+    }
+
+    while (!frontier.empty()) {
+      parallel_for(frontier.size(), n_threads,
+          [&](int tid, int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          int32_t v = frontier[i];
+          for (auto u = adj.adj_begin(v); u != adj.adj_end(v); ++u) {
+            if (__atomic_load_n(&core[*u], __ATOMIC_RELAXED) >= 0
+                || __atomic_load_n(&degree[*u], __ATOMIC_RELAXED) <= k) {
+              continue;
+            }
+
+            // Exactly one thread brings u down to k.
+            int32_t d = __atomic_fetch_sub(&degree[*u], 1, __ATOMIC_RELAXED);
+            if (d == k + 1) {
+              __atomic_store_n(&core[*u], k, __ATOMIC_RELAXED);
+              bufs[tid].push_back(*u);
+            } else if (d <= k) {
+              __atomic_fetch_add(&degree[*u], 1, __ATOMIC_RELAXED);
+            }
+          }
+        }
+      });
+      frontier = join(bufs);
+    }
+
+    // Drop removed nodes, and skip to the lowest remaining degree.
+    std::fill(min_degree.begin(), min_degree.end(), INT_MAX);
+    parallel_for(remaining.size(), n_threads,
+        [&](int tid, int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        int32_t v = remaining[i];
+        if (core[v] < 0) {
+          bufs[tid].push_back(v);
+          min_degree[tid] = std::min(min_degree[tid], degree[v]);
+        }
+      }
+    });
+    remaining = join(bufs);
+
+    k = std::max(k + 1, *std::min_element(min_degree.begin(),
+          min_degree.end()));
+  }
+
+  return core;
+}
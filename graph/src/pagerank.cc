@@ -0,0 +1,88 @@
+#include <cmath>
+#include <algorithm>
+#include "pagerank.h"
+#include "task_pool.h"
+
+namespace {
+
+double sum_partials(const std::vector<padded_t<double> > &partials) {
+  double sum = 0;
+  for (auto &p : partials) {
+    sum += p.value;
+  }
+  return sum;
+}
+
+}
+
+pagerank_t::pagerank_t(const csr_t &adj, const float damping)
+  : adj(adj), damping(damping), delta(0) {
+  int32_t num_nodes = adj.get_num_nodes();
+  ranks.assign(num_nodes, 1.0f / num_nodes);
+  contrib.resize(num_nodes);
+  sums.resize(num_nodes);
+}
+
+int pagerank_t::run(const int max_iterations, const float tolerance,
+                    const int n_threads) {
+  int32_t num_nodes = adj.get_num_nodes();
+  std::vector<padded_t<double> > partials(std::max(n_threads, 1));
+  int iter = 0;
+
+  while (iter < max_iterations) {
+    // Ranks to pass on, and the ranks of nodes with nowhere to pass them.
+    for (auto &p : partials) {
+      p.value = 0;
+    }
+    parallel_for(num_nodes, n_threads,
+        [&](int tid, int64_t begin, int64_t end) {
+      double dangling = 0;
+      for (int64_t v = begin; v < end; ++v) {
+        int32_t degree = adj.get_degree(v);
+        if (degree) {
+          contrib[v] = ranks[v] / degree;
+        } else {
+          contrib[v] = 0;
+          dangling += ranks[v];
+        }
+      }
+      partials[tid].value += dangling;
+    });
+    double dangling = sum_partials(partials);
+
+    adj.spmv(contrib.data(), sums.data(), n_threads);
+
+    float base = (1.0f - damping) / num_nodes
+      + damping * (float)dangling / num_nodes;
+
+    for (auto &p : partials) {
+      p.value = 0;
+    }
+    parallel_for(num_nodes, n_threads,
+        [&](int tid, int64_t begin, int64_t end) {
+      double change = 0;
+      for (int64_t v = begin; v < end; ++v) {
+        float rank = base + damping * sums[v];
+        change += std::fabs(rank - ranks[v]);
+        ranks[v] = rank;
+      }
+      partials[tid].value += change;
+    });
+    delta = sum_partials(partials);
+
+    ++iter;
+    if (delta < tolerance) {
+      break;
+    }
+  }
+
+  return iter;
+}
+
+float pagerank_t::get_delta() const {
+  return delta;
+}
+
+const std::vector<float>& pagerank_t::get_ranks() const {
+  return ranks;
+}
@@ -0,0 +1,150 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "graph.h"
+#include "snapshot.h"
+
+// Offsets first, so the adjacent nodes are gathered twice: once to count
+// them, once to write them.
+bool graph::save(const char *path) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << "(save) cannot open " << path << std::endl;
+    return false;
+  }
+
+  std::vector<int64_t> offsets(num_nodes + 1);
+  for (int32_t v = 0; v < num_nodes; ++v) {
+    offsets[v + 1] = offsets[v] + get_degree(v);
+  }
+
+  graph_snapshot_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, GRAPH_SNAPSHOT_MAGIC, sizeof(GRAPH_SNAPSHOT_MAGIC));
+  header.version = GRAPH_SNAPSHOT_VERSION;
+  header.num_nodes = num_nodes;
+  header.num_edges = offsets[num_nodes];
+  out.write((const char*)&header, sizeof(header));
+  out.write((const char*)offsets.data(), offsets.size() * sizeof(int64_t));
+
+  std::vector<int32_t> adj_nodes;
+  for (int32_t v = 0; v < num_nodes; ++v) {
+    adj_nodes.clear();
+    for_each_adj(v, [&](int32_t u) { adj_nodes.push_back(u); });
+    if (!is_sorted_adj()) {
+      std::sort(adj_nodes.begin(), adj_nodes.end());
+    }
+    out.write((const char*)adj_nodes.data(),
+        adj_nodes.size() * sizeof(int32_t));
+  }
+
+  if (!out) {
+    std::cerr << "(save) cannot write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+graph_snapshot_t::graph_snapshot_t ()
+  : map(nullptr), map_size(0), num_nodes(0), num_edges(0),
+    offsets(nullptr), adj(nullptr) {
+}
+
+graph_snapshot_t::~graph_snapshot_t () {
+  close();
+}
+
+bool graph_snapshot_t::open(const char *path) {
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "(open) cannot open " << path << std::endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0
+      || (size_t)st.st_size < sizeof(graph_snapshot_header_t)) {
+    std::cerr << "(open) " << path << " is not a snapshot" << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "(open) cannot map " << path << std::endl;
+    return false;
+  }
+  map = addr;
+  map_size = st.st_size;
+
+  const graph_snapshot_header_t *header = (const graph_snapshot_header_t*)map;
+  if (memcmp(header->magic, GRAPH_SNAPSHOT_MAGIC,
+        sizeof(GRAPH_SNAPSHOT_MAGIC))
+      || header->version != GRAPH_SNAPSHOT_VERSION
+      || header->num_nodes < 0 || header->num_nodes > INT32_MAX
+      || header->num_edges < 0
+      || header->num_edges > (int64_t)(map_size / sizeof(int32_t))
+      || map_size != sizeof(*header)
+                     + (header->num_nodes + 1) * sizeof(int64_t)
+                     + header->num_edges * sizeof(int32_t)) {
+    std::cerr << "(open) " << path << " is not a snapshot" << std::endl;
+    close();
+    return false;
+  }
+
+  // Offsets that grow from 0 to num_edges keep every adjacency in the
+  // file. Adjacent nodes aren't checked, as that reads the whole file.
+  const int64_t *file_offsets = (const int64_t*)(header + 1);
+  bool in_file = file_offsets[0] == 0
+    && file_offsets[header->num_nodes] == header->num_edges;
+  for (int64_t v = 0; in_file && v < header->num_nodes; ++v) {
+    in_file = file_offsets[v] <= file_offsets[v + 1];
+  }
+  if (!in_file) {
+    std::cerr << "(open) " << path << " has offsets out of the snapshot"
+      << std::endl;
+    close();
+    return false;
+  }
+
+  num_nodes = header->num_nodes;
+  num_edges = header->num_edges;
+  offsets = file_offsets;
+  adj = (const int32_t*)(offsets + num_nodes + 1);
+  return true;
+}
+
+void graph_snapshot_t::close() {
+  if (map) {
+    munmap(map, map_size);
+  }
+  map = nullptr;
+  map_size = 0;
+  num_nodes = 0;
+  num_edges = 0;
+  offsets = nullptr;
+  adj = nullptr;
+}
+
+int32_t graph_snapshot_t::get_num_nodes() const {
+  return num_nodes;
+}
+
+int64_t graph_snapshot_t::get_num_edges() const {
+  return num_edges;
+}
+
+int32_t graph_snapshot_t::get_degree(const int32_t node) const {
+  return offsets[node + 1] - offsets[node];
+}
+
+bool graph_snapshot_t::has_edge(const int32_t from, const int32_t to) const {
+  return std::binary_search(adj_begin(from), adj_end(from), to);
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include "triangle.h"
+#include "task_pool.h"
+
+namespace {
+
+// Bit per node, set for the nodes of a list.
+// Clearing zeroes whole words, as only the bits of the list are set.
+typedef std::vector<uint64_t> bitmap_t;
+
+inline void set_bits(bitmap_t &bits, const int32_t *begin,
+                     const int32_t *end, const bool on) {
+  for (auto w = begin; w != end; ++w) {
+    if (on) {
+      bits[*w >> 6] |= 1ULL << (*w & 63);
+    } else {
+      bits[*w >> 6] = 0;
+    }
+  }
+}
+
+inline bool test_bit(const bitmap_t &bits, const int32_t w) {
+  return (bits[w >> 6] >> (w & 63)) & 1;
+}
+
+}
+
+int64_t count_triangles(const csr_t &adj, const int n_threads,
+                        std::vector<int64_t> *per_node) {
+  int32_t num_nodes = adj.get_num_nodes();
+
+  auto ranked_above = [&](int32_t u, int32_t v) {
+    int32_t du = adj.get_degree(u), dv = adj.get_degree(v);
+    return dv > du || (dv == du && v > u);
+  };
+
+  // A(u): adjacent nodes ranked above u.
+  std::vector<int64_t> offsets(num_nodes + 1);
+  parallel_for(num_nodes, n_threads, [&](int, int64_t begin, int64_t end) {
+    for (int64_t u = begin; u < end; ++u) {
+      int64_t n_above = 0;
+      for (auto v = adj.adj_begin(u); v != adj.adj_end(u); ++v) {
+        n_above += ranked_above(u, *v);
+      }
+      offsets[u + 1] = n_above;
+    }
+  });
+  for (int32_t u = 0; u < num_nodes; ++u) {
+    offsets[u + 1] += offsets[u];
+  }
+
+  std::vector<int32_t> above(offsets[num_nodes]);
+  parallel_for(num_nodes, n_threads, [&](int, int64_t begin, int64_t end) {
+    for (int64_t u = begin; u < end; ++u) {
+      int32_t *out = above.data() + offsets[u];
+      for (auto v = adj.adj_begin(u); v != adj.adj_end(u); ++v) {
+        if (ranked_above(u, *v)) {
+          *out++ = *v;
+        }
+      }
+    }
+  });
+
+  if (per_node) {
+    per_node->assign(num_nodes, 0);
+  }
+  int64_t *counts = per_node ? per_node->data() : nullptr;
+
+  std::vector<padded_t<int64_t> > partials(std::max(n_threads, 1));
+
+  // A(u), the nodes above u, is set in a bitmap of the thread, and
+  // each w of A(v), for v in A(u), is tested against it. That costs
+  // |A(v)| per edge, where merging A(u) and A(v) costs |A(u)| + |A(v)|
+  // with a branch miss per step.
+  std::vector<bitmap_t> bitmaps(std::max(n_threads, 1),
+      bitmap_t(num_nodes / 64 + 1));
+
+  // Work per node is skewed, so take small chunks.
+  parallel_for(num_nodes, n_threads, [&](int tid, int64_t begin, int64_t end) {
+    bitmap_t &bits = bitmaps[tid];
+    int64_t count = 0;
+
+    for (int64_t u = begin; u < end; ++u) {
+      const int32_t *u_begin = above.data() + offsets[u];
+      const int32_t *u_end = above.data() + offsets[u + 1];
+      set_bits(bits, u_begin, u_end, true);
+
+      for (auto v = u_begin; v != u_end; ++v) {
+        const int32_t *v_begin = above.data() + offsets[*v];
+        const int32_t *v_end = above.data() + offsets[*v + 1];
+
+        if (counts) {
+          for (auto w = v_begin; w != v_end; ++w) {
+            if (test_bit(bits, *w)) {
+              __atomic_fetch_add(&counts[u], 1, __ATOMIC_RELAXED);
+              __atomic_fetch_add(&counts[*v], 1, __ATOMIC_RELAXED);
+              __atomic_fetch_add(&counts[*w], 1, __ATOMIC_RELAXED);
+              count++;
+            }
+          }
+        } else {
+          for (auto w = v_begin; w != v_end; ++w) {
+            count += test_bit(bits, *w);
+          }
+        }
+      }
+
+      set_bits(bits, u_begin, u_end, false);
+    }
+    partials[tid].value += count;
+  }, 64);
+
+  int64_t total = 0;
+  for (auto &p : partials) {
+    total += p.value;
+  }
+  return total;
+}
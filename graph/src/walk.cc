@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <iostream>
+#include "walk.h"
+
+// Groups of walks per chunk of parallel_for().
+#define WALK_CHUNK 16
+
+namespace {
+
+// Finalizer of splitmix64.
+inline uint64_t mix(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// splitmix64: a 64 bit state and a multiply-xorshift per number.
+inline uint64_t next_random(uint64_t &state) {
+  return mix(state += 0x9e3779b97f4a7c15ULL);
+}
+
+// A number below n from the high half of r, without a division (Lemire),
+// and a number in [0, 1) from its low 24 bits.
+inline int64_t random_below(const uint64_t r, const int64_t n) {
+  return (int64_t)(((r >> 32) * (uint64_t)n) >> 32);
+}
+
+inline float random_unit(const uint64_t r) {
+  return (r & 0xffffff) * (1.0f / (1 << 24));
+}
+
+}
+
+random_walker_t::random_walker_t(const csr_t &adj)
+  : adj(adj), second_order(false), return_bias(1), out_bias(1),
+    max_bias(1), min_bias(1) {
+  int32_t num_nodes = adj.get_num_nodes();
+  offsets.resize(num_nodes + 1);
+  if (adj.get_num_segments() != 1) {
+    std::cerr << "(random_walker_t) the csr_t has "
+      << adj.get_num_segments() << " segments, not 1" << std::endl;
+    adj_nodes = nullptr;
+    return;
+  }
+
+  adj_nodes = adj.adj_begin(0);
+  for (int32_t v = 0; v < num_nodes; ++v) {
+    offsets[v + 1] = offsets[v] + adj.get_degree(v);
+  }
+}
+
+void random_walker_t::set_uniform() {
+  prob.clear();
+  alias.clear();
+}
+
+bool random_walker_t::set_node2vec(const float p, const float q) {
+  if (!(p > 0 && q > 0)) {
+    std::cerr << "(set_node2vec) p " << p << " and q " << q
+      << " must be above 0" << std::endl;
+    return false;
+  }
+  return_bias = 1.0f / p;
+  out_bias = 1.0f / q;
+  max_bias = std::max(1.0f, std::max(return_bias, out_bias));
+  min_bias = std::min(1.0f, std::min(return_bias, out_bias));
+  second_order = p != 1.0f || q != 1.0f;
+  return true;
+}
+
+// Vose: entries below the average weight are topped up to it by an entry
+// above, which becomes their alias, until every entry is at the average.
+void random_walker_t::build_alias(const int32_t node,
+                                  std::vector<int32_t> &small,
+                                  std::vector<int32_t> &large) {
+  float *p = prob.data() + offsets[node];
+  int32_t *a = alias.data() + offsets[node];
+  int32_t degree = offsets[node + 1] - offsets[node];
+
+  double sum = 0;
+  for (int32_t i = 0; i < degree; ++i) {
+    sum += p[i];
+  }
+
+  small.clear();
+  large.clear();
+  for (int32_t i = 0; i < degree; ++i) {
+    a[i] = i;
+    p[i] = sum > 0 ? p[i] * degree / sum : 1.0f;
+    (p[i] < 1.0f ? small : large).push_back(i);
+  }
+
+  while (!small.empty() && !large.empty()) {
+    int32_t s = small.back(), l = large.back();
+    small.pop_back();
+    a[s] = l;
+    p[l] -= 1.0f - p[s];
+    if (p[l] < 1.0f) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // What is left is at the average, but for rounding.
+  for (auto i : small) {
+    p[i] = 1.0f;
+  }
+  for (auto i : large) {
+    p[i] = 1.0f;
+  }
+}
+
+int64_t random_walker_t::walk(const int32_t *starts, const int64_t n_walks,
+                              const int32_t walk_length, int32_t *out,
+                              const uint64_t seed,
+                              const int n_threads) const {
+  if (walk_length <= 0) {
+    return 0;
+  }
+  for (int64_t i = 0; i < n_walks; ++i) {
+    if (starts[i] < 0 || starts[i] >= adj.get_num_nodes()) {
+      std::cerr << "(walk) start " << starts[i] << " of walk " << i
+        << " is not a node" << std::endl;
+      return -1;
+    }
+  }
+
+  std::vector<padded_t<int64_t> > partials(std::max(n_threads, 1));
+  int64_t n_groups = (n_walks + WALK_GROUP - 1) / WALK_GROUP;
+
+  parallel_for(n_groups, n_threads,
+      [&](int tid, int64_t begin, int64_t end) {
+    int64_t n_steps = 0;
+    for (int64_t g = begin; g < end; ++g) {
+      int64_t first = g * WALK_GROUP;
+      int n = (int)std::min((int64_t)WALK_GROUP, n_walks - first);
+      walk_group(starts, first, n, walk_length, out, seed, n_steps);
+    }
+    partials[tid].value += n_steps;
+  }, WALK_CHUNK);
+
+  int64_t n_steps = 0;
+  for (auto &p : partials) {
+    n_steps += p.value;
+  }
+  return n_steps;
+}
+
+// Each step is in two passes over the group. The first draws an entry of
+// the adjacency of each walk and prefetches it, the second reads them,
+// and prefetches the offsets of the nodes reached for the next step.
+// Retries of the second order rejection aren't prefetched.
+void random_walker_t::walk_group(const int32_t *starts, const int64_t first,
+                                 const int n, const int32_t walk_length,
+                                 int32_t *out, const uint64_t seed,
+                                 int64_t &n_steps) const {
+  uint64_t state[WALK_GROUP];
+  int32_t node[WALK_GROUP], prev[WALK_GROUP];
+  int64_t entry[WALK_GROUP];
+  float coin[WALK_GROUP];
+  bool weighted = !prob.empty();
+
+  // The entry of node v drawn by r, but for its alias.
+  auto draw = [&](int32_t v, uint64_t r) {
+    return offsets[v] + random_below(r, offsets[v + 1] - offsets[v]);
+  };
+  auto resolve = [&](int32_t v, int64_t e, float c) {
+    return weighted && c >= prob[e] ? offsets[v] + alias[e] : e;
+  };
+  // Below the smallest bias, x is kept without searching t's nodes.
+  auto accept = [&](int32_t t, int32_t x, float level) {
+    if (level < min_bias) {
+      return true;
+    } else if (x == t) {
+      return level < return_bias;
+    }
+    return level < (std::binary_search(adj_nodes + offsets[t],
+        adj_nodes + offsets[t + 1], x) ? 1.0f : out_bias);
+  };
+
+  int alive = n;
+  for (int i = 0; i < n; ++i) {
+    state[i] = mix(seed + mix(first + i));
+    node[i] = starts[first + i];
+    prev[i] = -1;
+    out[(first + i) * walk_length] = node[i];
+  }
+
+  for (int32_t step = 1; step < walk_length && alive; ++step) {
+    for (int i = 0; i < n; ++i) {
+      entry[i] = -1;
+      int32_t v = node[i];
+      if (v < 0 || offsets[v] == offsets[v + 1]) {
+        continue;
+      }
+      uint64_t r = next_random(state[i]);
+      entry[i] = draw(v, r);
+      coin[i] = random_unit(r);
+      __builtin_prefetch(adj_nodes + entry[i]);
+      if (weighted) {
+        __builtin_prefetch(prob.data() + entry[i]);
+        __builtin_prefetch(alias.data() + entry[i]);
+      }
+    }
+
+    for (int i = 0; i < n; ++i) {
+      int32_t *walk_out = out + (first + i) * walk_length;
+      int32_t v = node[i];
+      if (v < 0) {
+        continue;
+      }
+      if (entry[i] < 0) {
+        std::fill(walk_out + step, walk_out + walk_length, -1);
+        node[i] = -1;
+        --alive;
+        continue;
+      }
+
+      int32_t x = adj_nodes[resolve(v, entry[i], coin[i])];
+      if (second_order && prev[i] >= 0) {
+        uint64_t r = next_random(state[i]);
+        while (!accept(prev[i], x, random_unit(r) * max_bias)) {
+          r = next_random(state[i]);
+          x = adj_nodes[resolve(v, draw(v, r), random_unit(r))];
+          r = next_random(state[i]);
+        }
+      }
+
+      walk_out[step] = x;
+      prev[i] = v;
+      node[i] = x;
+      ++n_steps;
+      __builtin_prefetch(offsets.data() + x);
+    }
+  }
+}
@@ -0,0 +1,452 @@
+/* Work-stealing task pool, shared by the modules.
+ *
+ * Each worker thread owns a Chase-Lev deque of tasks. It pushes and pops
+ * its own tasks at the bottom, newest first, and idle workers steal from
+ * the top of the others, oldest and so largest first. Threads that aren't
+ * workers, e.g. main, hand their tasks to an injection queue instead.
+ * A thread waiting for its tasks runs other tasks in the meantime, so
+ * nested fork_join() and parallel_for() neither block nor deadlock.
+ * Idle workers sleep on a condition variable.
+ *
+ * task_pool_t::instance() is created on first use, with a worker per
+ * hardware thread but the caller's. Tasks then cost a push and a pop
+ * instead of a thread creation.
+ *
+ * Header only, so every module can include it from ../sched/. */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <functional>
+
+#define TASK_POOL_CACHE_LINE 64
+
+class task_t
+{
+public:
+  task_t () : pending(nullptr) {}
+  virtual ~task_t () {}
+
+  virtual void run() = 0;
+
+  // Run, then count the task as done. The task may be gone afterwards.
+  void execute() {
+    std::atomic<int> *counter = pending;
+    run();
+    counter->fetch_sub(1, std::memory_order_release);
+  }
+
+  std::atomic<int> *pending; // tasks of the waiter not done yet
+};
+
+/* Chase-Lev deque, with the memory orders of Le et al., "Correct and
+ * efficient work-stealing for weak memory models", PPoPP 2013.
+ * Only its owner calls push() and pop(). The array grows by doubling;
+ * old arrays are kept until the deque is gone, as a thief may still be
+ * reading one. */
+class ws_deque_t
+{
+public:
+  ws_deque_t () : top(0), bottom(0) {
+    array_t *a = new array_t(256);
+    arrays.push_back(a);
+    array.store(a, std::memory_order_relaxed);
+  }
+
+  virtual ~ws_deque_t () {
+    for (auto a : arrays) {
+      delete a;
+    }
+  }
+
+  void push(task_t *task) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    array_t *a = array.load(std::memory_order_relaxed);
+
+    if (b - t > a->size - 1) {
+      a = grow(a, t, b);
+    }
+    a->put(b, task);
+    bottom.store(b + 1, std::memory_order_release);
+  }
+
+  // nullptr if the deque is empty.
+  task_t* pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    array_t *a = array.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    task_t *task = a->get(b);
+    if (t == b) {
+      // The last task: race the thieves for it.
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+            std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  // nullptr if the deque is empty or another thread took the task first.
+  task_t* steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b) {
+      return nullptr;
+    }
+
+    task_t *task = array.load(std::memory_order_acquire)->get(t);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+          std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+  bool empty() const {
+    return top.load(std::memory_order_relaxed)
+      >= bottom.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct array_t {
+    int64_t size;
+    std::atomic<task_t*> *slots;
+
+    explicit array_t(int64_t size)
+      : size(size), slots(new std::atomic<task_t*>[size]) {}
+    ~array_t() { delete[] slots; }
+
+    task_t* get(int64_t i) {
+      return slots[i & (size - 1)].load(std::memory_order_relaxed);
+    }
+    void put(int64_t i, task_t *task) {
+      slots[i & (size - 1)].store(task, std::memory_order_relaxed);
+    }
+  };
+
+  array_t* grow(array_t *a, int64_t t, int64_t b) {
+    array_t *bigger = new array_t(2 * a->size);
+    for (int64_t i = t; i < b; ++i) {
+      bigger->put(i, a->get(i));
+    }
+    arrays.push_back(bigger);
+    array.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  // Thieves update top and the owner bottom, so they have lines of their
+  // own.
+  std::atomic<int64_t> top;
+  char pad_top[TASK_POOL_CACHE_LINE - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> bottom;
+  char pad_bottom[TASK_POOL_CACHE_LINE - sizeof(std::atomic<int64_t>)];
+  std::atomic<array_t*> array;
+  std::vector<array_t*> arrays; // the owner's, to free them
+};
+
+class task_pool_t
+{
+public:
+  explicit task_pool_t (const int n_workers) : stop(false), n_sleeping(0),
+      n_injected(0), deques(n_workers) {
+    for (int i = 0; i < n_workers; ++i) {
+      deques[i] = new ws_deque_t();
+    }
+    for (int i = 0; i < n_workers; ++i) {
+      workers.emplace_back(&task_pool_t::worker_main, this, i);
+    }
+  }
+
+  virtual ~task_pool_t () {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop.store(true);
+    }
+    wake_up.notify_all();
+    for (auto &w : workers) {
+      w.join();
+    }
+    for (auto d : deques) {
+      delete d;
+    }
+  }
+
+  // The pool of the process, created on first use.
+  static task_pool_t& instance() {
+    static task_pool_t pool(
+        std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+  }
+
+  int get_num_workers() const {
+    return workers.size();
+  }
+
+  // Queue task. wait() returns once it has run.
+  void spawn(task_t *task, std::atomic<int> &pending) {
+    task->pending = &pending;
+    pending.fetch_add(1, std::memory_order_relaxed);
+
+    int id = worker_id();
+    if (id >= 0) {
+      deques[id]->push(task);
+    } else {
+      std::lock_guard<std::mutex> lock(mutex);
+      injected.push_back(task);
+      n_injected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Pairs with the fence in sleep(): either a sleeping worker is seen
+    // here, or the worker sees the task before it sleeps.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (n_sleeping.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(mutex);
+      wake_up.notify_one();
+    }
+  }
+
+  // Run other tasks until every task counted by pending is done.
+  void wait(std::atomic<int> &pending) {
+    int id = worker_id();
+    while (pending.load(std::memory_order_acquire) > 0) {
+      task_t *task = find_task(id, id < 0);
+      if (task) {
+        task->execute();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // Run f and g, possibly at the same time, and return when both are done.
+  template <typename F, typename G>
+  void fork_join(F f, G g) {
+    func_task_t<F> task(f);
+    std::atomic<int> pending(0);
+
+    spawn(&task, pending);
+    g();
+    wait(pending);
+  }
+
+  /* Run f(tid, begin, end) over chunks of [0, n) in up to n_threads tasks.
+   * Chunks are taken dynamically, so skewed chunks don't leave the other
+   * tasks idle. tid is in [0, n_threads), e.g. to index per task partial
+   * sums. The caller runs as task 0. */
+  template <typename F>
+  void parallel_for(const int64_t n, const int n_threads, F f,
+                    const int64_t chunk = 1024) {
+    if (n_threads <= 1 || n <= chunk) {
+      if (n > 0) {
+        f(0, (int64_t)0, n);
+      }
+      return;
+    }
+
+    std::atomic<int64_t> next(0);
+    auto body = [&](int tid) {
+      while (true) {
+        int64_t begin = next.fetch_add(chunk);
+        if (begin >= n) {
+          break;
+        }
+        f(tid, begin, std::min(begin + chunk, n));
+      }
+    };
+
+    int n_tasks = std::min<int64_t>(n_threads, (n + chunk - 1) / chunk);
+    std::vector<for_task_t<decltype(body)>> tasks;
+    tasks.reserve(n_tasks - 1);
+    std::atomic<int> pending(0);
+    for (int tid = 1; tid < n_tasks; ++tid) {
+      tasks.emplace_back(body, tid);
+      spawn(&tasks.back(), pending);
+    }
+    body(0);
+    wait(pending);
+  }
+
+private:
+  template <typename F>
+  class func_task_t : public task_t {
+  public:
+    explicit func_task_t (F &f) : f(f) {}
+    void run() { f(); }
+  private:
+    F &f;
+  };
+
+  template <typename F>
+  class for_task_t : public task_t {
+  public:
+    for_task_t (F &f, int tid) : f(f), tid(tid) {}
+    void run() { f(tid); }
+  private:
+    F &f;
+    int tid;
+  };
+
+  // Index of the calling thread's deque, or -1 if it isn't a worker.
+  int worker_id() {
+    return current_pool() == this ? current_id() : -1;
+  }
+
+  // Own deque first, then a steal from a worker picked at random, then
+  // the injection queue, oldest first. Threads that aren't workers wait
+  // for tasks they injected: they take the newest injected task first,
+  // as it is likely theirs. An older one may be an outer task, whose
+  // forks would pile up on their stack.
+  task_t* find_task(const int id, const bool newest = false) {
+    task_t *task = nullptr;
+    if (id >= 0) {
+      task = deques[id]->pop();
+    } else if (newest) {
+      task = take_injected(true);
+    }
+
+    int n = deques.size();
+    if (!task && n > 0) {
+      int first = next_victim() % n;
+      for (int i = 0; i < n && !task; ++i) {
+        int victim = (first + i) % n;
+        if (victim != id) {
+          task = deques[victim]->steal();
+        }
+      }
+    }
+
+    if (!task && !newest) {
+      task = take_injected(false);
+    }
+    return task;
+  }
+
+  task_t* take_injected(const bool newest) {
+    if (n_injected.load(std::memory_order_relaxed) == 0) {
+      return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (injected.empty()) {
+      return nullptr;
+    }
+    task_t *task;
+    if (newest) {
+      task = injected.back();
+      injected.pop_back();
+    } else {
+      task = injected.front();
+      injected.pop_front();
+    }
+    n_injected.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+  }
+
+  bool has_task() {
+    if (n_injected.load(std::memory_order_relaxed) > 0) {
+      return true;
+    }
+    for (auto d : deques) {
+      if (!d->empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void sleep() {
+    std::unique_lock<std::mutex> lock(mutex);
+    n_sleeping.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!has_task() && !stop.load()) {
+      wake_up.wait(lock);
+    }
+    n_sleeping.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void worker_main(const int id) {
+    current_pool() = this;
+    current_id() = id;
+
+    int n_idle = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      task_t *task = find_task(id);
+      if (task) {
+        task->execute();
+        n_idle = 0;
+      } else if (++n_idle < 64) {
+        std::this_thread::yield();
+      } else {
+        sleep();
+        n_idle = 0;
+      }
+    }
+  }
+
+  // Per thread, as functions: C++11 has no inline variables.
+  static task_pool_t*& current_pool() {
+    static thread_local task_pool_t *pool = nullptr;
+    return pool;
+  }
+  static int& current_id() {
+    static thread_local int id = -1;
+    return id;
+  }
+  static uint32_t next_victim() {
+    static thread_local uint32_t x = std::hash<std::thread::id>()(
+        std::this_thread::get_id()) | 1;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+  }
+
+  std::atomic<bool> stop;
+  std::atomic<int> n_sleeping;
+  std::atomic<int> n_injected;
+  std::mutex mutex; // for injected and wake_up
+  std::condition_variable wake_up;
+  std::deque<task_t*> injected;
+  std::vector<ws_deque_t*> deques;
+  std::vector<std::thread> workers;
+};
+
+// fork_join() and parallel_for() on the pool of the process.
+template <typename F, typename G>
+void fork_join(F f, G g) {
+  task_pool_t::instance().fork_join(f, g);
+}
+
+template <typename F>
+void parallel_for(const int64_t n, const int n_threads, F f,
+                  const int64_t chunk = 1024) {
+  task_pool_t::instance().parallel_for(n, n_threads, f, chunk);
+}
+
+// A value of each thread of parallel_for(), e.g. a partial sum, on a
+// cache line of its own. std::vector<padded_t<T> >(n) sets them to 0.
+// Not alignas: std::vector doesn't align beyond max_align_t before C++17.
+template <typename T>
+struct padded_t {
+  T value;
+  char pad[TASK_POOL_CACHE_LINE - sizeof(T) % TASK_POOL_CACHE_LINE];
+};